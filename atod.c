@@ -29,6 +29,7 @@
 
 #include "gb_common.h"
 #include "gb_spi.h"
+#include "gb_opts.h"
 
 // Set GPIO pins to the right mode
 // DEMO GPIO mapping:
@@ -64,29 +65,31 @@ void setup_gpio()
 
 //
 //  Read ADC input 0 and show as horizontal bar
+//  (with -b just read it as often or as fast as we are told)
 //
-void main(void)
-{ int r, v, s, i, chan;
+void main(int argc, char **argv)
+{ int v, s, i, chan;
+  struct gb_opts o;
 
-  do {
-    printf ("Which channel do you want to test? Type 0 or 1.\n");
-    chan  = (int) getchar();
-    (void) getchar(); // eat carriage return
-  } while (chan != '0' && chan != '1');
-  chan = chan - '0';
+  setup_opts(&o, argc, argv, 100000, 0, 1);
+  chan = opts_channel(&o, "Which channel do you want to test? Type 0 or 1.",
+                      0, 1);
 
-  printf ("These are the connections for the analogue to digital test:\n");
-  printf ("jumper connecting GP11 to SCLK\n");
-  printf ("jumper connecting GP10 to MOSI\n");
-  printf ("jumper connecting GP9 to MISO\n");
-  printf ("jumper connecting GP8 to CSnA\n");
-  printf ("Potentiometer connections:\n");
-  printf ("  (call 1 and 3 the ends of the resistor and 2 the wiper)\n");
-  printf ("  connect 3 to 3V3\n");
-  printf ("  connect 2 to AD%d\n", chan);
-  printf ("  connect 1 to GND\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+  if (!o.batch)
+  {
+    printf ("These are the connections for the analogue to digital test:\n");
+    printf ("jumper connecting GP11 to SCLK\n");
+    printf ("jumper connecting GP10 to MOSI\n");
+    printf ("jumper connecting GP9 to MISO\n");
+    printf ("jumper connecting GP8 to CSnA\n");
+    printf ("Potentiometer connections:\n");
+    printf ("  (call 1 and 3 the ends of the resistor and 2 the wiper)\n");
+    printf ("  connect 3 to 3V3\n");
+    printf ("  connect 2 to AD%d\n", chan);
+    printf ("  connect 1 to GND\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
@@ -101,9 +104,12 @@ void main(void)
   // simply printing out the value isn't very useful. The bar graph
   // is better because this hides the noise in the signal.
 
-  for (r=0; r<100000; r++)
+  while (next_iteration(&o))
   {
     v= read_adc(chan);
+    opts_value(&o, v);
+    if (o.batch)
+      continue;
     // V should be in range 0-1023
     // map to 0-63
     s = v >> 4;
@@ -117,6 +123,8 @@ void main(void)
     short_wait();
   } // repeated read
 
-  printf("\n");
+  if (!o.batch)
+    printf("\n");
+  print_summary(&o);
   restore_io();
 } // main
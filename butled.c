@@ -26,6 +26,10 @@
 //
 
 #include "gb_common.h"
+#include "gb_edge.h"
+#include "gb_debounce.h"
+#include "gb_event.h"
+#include "gb_opts.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -94,18 +98,27 @@ void unpull_pins()
 } // unpull_pins
 
 
-int main(void)
-{ int r,d;
-  unsigned int b,prev_b;
+int main(int argc, char **argv)
+{ unsigned int b;
+  unsigned long long t0;
+  struct event_reader rd;
+  struct gb_event ev;
+  struct gb_opts o;
   char str [3];
 
-  printf ("These are the connections you must make on the Gertboard for this test:\n");
-  printf ("GP23 in J2 --- B3 in J3\n");
-  printf ("GP22 in J2 --- B6 in J3\n");
-  printf ("U3-out-B3 pin 1 --- BUF6 in top header\n");
-  printf ("jumper on U4-in-B6\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+  // an iteration is one change on one of the two inputs
+  setup_opts(&o, argc, argv, 20, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections you must make on the Gertboard for this test:\n");
+    printf ("GP23 in J2 --- B3 in J3\n");
+    printf ("GP22 in J2 --- B6 in J3\n");
+    printf ("U3-out-B3 pin 1 --- BUF6 in top header\n");
+    printf ("jumper on U4-in-B6\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
    // Map the I/O sections
    setup_io();
@@ -113,32 +126,42 @@ int main(void)
    // Set GPIO pins 23, 24, and 25 to the required mode
    setup_gpio();
 
-   // read the switches a number of times and print out the result
-
-   /* below we set prev_b to a number which will definitely be different
-      from what the switches returns, as after shift & mask, b can only
-      be in range 0..7 */
-   prev_b = 8; 
-   
-   r = 20; // number of repeats
-
-  while (r)
+   // let the kernel wake us up when one of the inputs changes
+   // instead of reading GPIO_IN0 as fast as we can
+   setup_edge(0x00C00000, EDGE_BOTH);
+
+   // The input sampler thread debounces bits 22 & 23 (samples taken
+   // 5ms apart, see gb_debounce.c) and queues every change as an event
+   // with a time stamp. We just wait for those events.
+   b = (GPIO_IN0 >> 22) & 0x03; // keep only bits 22 & 23
+   t0 = get_time_ns();
+   start_events(0x00C00000, 0, 5000000);
+   open_events(&rd);
+   make_binary_string(2, b, str);
+   printf("%s\n", str);
+
+  while (next_iteration(&o))
   {
-    b = GPIO_IN0;
-    b = (b >> 22 ) & 0x03; // keep only bits 22 & 23
-    if (b^prev_b)
-    { // one or more buttons changed
-      make_binary_string(2, b, str);
-      printf("%s\n", str);
-      prev_b = b;
-      r--;
-    } // change
+    if (!gb_next_event(&rd, &ev, opts_timeout_ms(&o)))
+      break; // -t is over
+    if (ev.edge == EDGE_RISING)
+      b |= 1 << (ev.pin - 22);
+    else
+      b &= ~(1 << (ev.pin - 22));
+    make_binary_string(2, b, str);
+    printf("%s  (GPIO%d %s at %.1f ms)\n", str, ev.pin,
+           ev.edge == EDGE_RISING ? "high" : "low", (ev.when - t0)/1e6);
   } // while
 
+  close_events(&rd);
+  stop_events();
+
   // disable pull up on pins & unmap gpio
+  print_edge_stats();
+  restore_edge();
   unpull_pins();
+  print_summary(&o);
   restore_io();
 
   return 0;
 } // main
-
@@ -27,6 +27,9 @@
 
 
 #include "gb_common.h"
+#include "gb_edge.h"
+#include "gb_debounce.h"
+#include "gb_opts.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -97,21 +100,28 @@ void unpull_pins()
    GPIO_PULLCLK0 = 0;
 } // unpull_pins
 
-int main(void)
-{ int r,d;
-  unsigned int b,prev_b;
+int main(int argc, char **argv)
+{ unsigned int b;
+  struct debounce deb;
+  struct gb_opts o;
   char str [4];
 
-  printf ("These are the connections for the buttons test:\n");
-  printf ("GP25 in J2 --- B1 in J3\n");
-  printf ("GP24 in J2 --- B2 in J3\n");
-  printf ("GP23 in J2 --- B3 in J3\n");
-  printf ("Optionally, if you want the LEDs to reflect button state do the following:\n");
-  printf ("jumper on U3-out-B1\n");
-  printf ("jumper on U3-out-B2\n");
-  printf ("jumper on U3-out-B3\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+  // an iteration is one debounced change of the buttons
+  setup_opts(&o, argc, argv, 20, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the buttons test:\n");
+    printf ("GP25 in J2 --- B1 in J3\n");
+    printf ("GP24 in J2 --- B2 in J3\n");
+    printf ("GP23 in J2 --- B3 in J3\n");
+    printf ("Optionally, if you want the LEDs to reflect button state do the following:\n");
+    printf ("jumper on U3-out-B1\n");
+    printf ("jumper on U3-out-B2\n");
+    printf ("jumper on U3-out-B3\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
    // Map the I/O sections
    setup_io();
@@ -119,32 +129,36 @@ int main(void)
    // Set GPIO pins 23, 24, and 25 to the required mode
    setup_gpio();
 
-   // read the switches a number of times and print out the result
-
-   /* below we set prev_b to a number which will definitely be different
-      from what the switches returns, as after shift & mask, b can only
-      be in range 0..7 */
-   prev_b = 8; 
-   
-   r = 20; // number of repeats
+   // let the kernel wake us up when one of the inputs changes
+   // instead of reading GPIO_IN0 as fast as we can
+   setup_edge(0x03800000, EDGE_BOTH);
 
-  while (r)
+   // read the switches a number of times and print out the result
+   // Every button bounces when pressed or released, so we only
+   // print a new value after all bits have been stable for 4 samples
+   // taken 5ms apart (see gb_debounce.c)
+   setup_debounce(&deb, 0x03800000, 0);
+   b = (deb.state >> 23) & 0x07; // keep only bits 23, 24 & 25
+   make_binary_string(3, b, str);
+   printf("%s\n", str);
+
+  while (next_iteration(&o))
   {
-    b = GPIO_IN0;
-    b = (b >> 23 ) & 0x07; // keep only bits 23, 24 & 25
-    if (b^prev_b)
-    { // one or more buttons changed
-      make_binary_string(3, b, str);
-      printf("%s\n", str);
-      prev_b = b;
-      r--;
-    } // change
+    // sample the inputs until a debounced change comes out,
+    // sleeping until the next edge when nothing is going on
+    if (!wait_debounced_until(&deb, 5000000, opts_deadline(&o), NULL, NULL))
+      break; // -t is over
+    b = (deb.state >> 23) & 0x07;
+    make_binary_string(3, b, str);
+    printf("%s\n", str);
   } // while
 
   // disable pull up on pins & unmap gpio
+  print_edge_stats();
+  restore_edge();
   unpull_pins();
+  print_summary(&o);
   restore_io();
 
   return 0;
 } // main
-
@@ -30,6 +30,7 @@
 
 #include "gb_common.h"
 #include "gb_spi.h"
+#include "gb_opts.h"
 
 // Set GPIO pins to the right mode
 // dad (digital-analogue-digital) GPIO mapping:
@@ -66,19 +67,30 @@ void setup_gpio()
 
 //
 //  Do digital to analogue to digital conversion
+//  Up in 9 steps of 32 and down again, 17 points per sweep. With -b
+//  nothing is shown, the summary has the difference between what we
+//  read and what we should read (in ADC steps) as the value.
 //
-void main(void)
-{ int d, dac_val, v, s, i;
+#define SWEEP 17
 
-  printf ("These are the connections for the digital to analogue to digital test:\n");
-  printf ("jumper connecting GP11 to SCLK\n");
-  printf ("jumper connecting GP10 to MOSI\n");
-  printf ("jumper connecting GP9 to MISO\n");
-  printf ("jumper connecting GP8 to CSnA\n");
-  printf ("jumper connecting GP7 to CSnB\n");
-  printf ("jumper connecting DA1 on J29 to AD0 on J28\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+void main(int argc, char **argv)
+{ int d, dac_val, v, s, i, step;
+  struct gb_opts o;
+
+  setup_opts(&o, argc, argv, SWEEP, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the digital to analogue to digital test:\n");
+    printf ("jumper connecting GP11 to SCLK\n");
+    printf ("jumper connecting GP10 to MOSI\n");
+    printf ("jumper connecting GP9 to MISO\n");
+    printf ("jumper connecting GP8 to CSnA\n");
+    printf ("jumper connecting GP7 to CSnB\n");
+    printf ("jumper connecting DA1 on J29 to AD0 on J28\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
@@ -93,32 +105,24 @@ void main(void)
   // simply printing out the value isn't very useful. The bar graph
   // is better because this hides the noise in the signal.
 
-  printf ("dig ana\n");
-  for (d=0; d <= 256; d+= 32)
+  if (!o.batch)
+    printf ("dig ana\n");
+  step = 0;
+  while (next_iteration(&o))
   {
+    // 0, 32 .. 256 and back down to 0
+    d = step <= SWEEP/2 ? step * 32 : (SWEEP-1 - step) * 32;
     if (d == 256) 
       dac_val = 255 * 16;
     else 
       dac_val = d * 16;
+    step = (step + 1) % SWEEP;
     write_dac(1, dac_val);
     v= read_adc(0);
-    // v should be in range 0-1023
-    // map to 0-63
-    s = v >> 4;
-    printf("%3x %04d ", dac_val, v);
-    // show horizontal bar
-    for (i = 0; i < s; i++)
-      putchar('#');
-    for (i = 0; i < 64 - s; i++)
-      putchar(' ');
-    putchar('\n');
-    short_wait();
-  } // repeated write/read
-  for (d=224; d >= 0; d-= 32)
-  {
-    dac_val = d * 16;
-    write_dac(1, dac_val);
-    v= read_adc(0);
+    // DAC: 2.048V full scale in 256 steps, ADC: 3.3V in 1024 steps
+    opts_value(&o, v - (long)(dac_val / 16 * 2.048 / 256 / 3.3 * 1024 + 0.5));
+    if (o.batch)
+      continue;
     // v should be in range 0-1023
     // map to 0-63
     s = v >> 4;
@@ -132,6 +136,8 @@ void main(void)
     short_wait();
   } // repeated write/read
 
-  printf("\n");
+  if (!o.batch)
+    printf("\n");
+  print_summary(&o);
   restore_io();
 } // main
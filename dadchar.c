@@ -0,0 +1,283 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// DAC to ADC characterisation
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// dad shows a few points of the D to A to D loop as bars. This program
+// measures the whole transfer curve: every DAC code is set, first going
+// up and then coming down again, and the ADC reads it a number of times.
+// For every step we get the mean and the noise (standard deviation).
+// A straight line through all means gives the gain and offset error,
+// the distance of every mean to that line the integral non-linearity
+// (INL) and the size of every step the differential non-linearity (DNL),
+// both in DAC steps. The difference between going up and coming down
+// shows hysteresis.
+//
+// Mean and variance are kept with Welford's method: one pass, no
+// samples stored and no loss of precision when the noise is small
+// compared to the value. The line is fitted the same way.
+//
+// Every step goes to a CSV file (or stdout) for plotting:
+//   sudo ./dadchar -n 32 -o dad.csv
+//
+
+#include "gb_common.h"
+#include "gb_spi.h"
+#include "gb_rt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+// dadchar GPIO mapping:
+//         Function            Mode
+// GPIO7=  SPI chip select B   Alt. 0
+// GPIO8=  SPI chip select A   Alt. 0
+// GPIO9=  SPI MISO            Alt. 0
+// GPIO10= SPI MOSI            Alt. 0
+// GPIO11= SPI CLK             Alt. 0
+
+void setup_gpio()
+{
+   INP_GPIO(7);  SET_GPIO_ALT(7,0);
+   INP_GPIO(8);  SET_GPIO_ALT(8,0);
+   INP_GPIO(9);  SET_GPIO_ALT(9,0);
+   INP_GPIO(10); SET_GPIO_ALT(10,0);
+   INP_GPIO(11); SET_GPIO_ALT(11,0);
+} // setup_gpio
+
+#define CODES      256   // 8-bit DAC (MCP4802)
+#define MAX_SAMPLE 4096
+#define UP         0
+#define DOWN       1
+
+// DAC: 2.048V full scale in 256 steps, ADC: 3.3V in 1024 steps
+#define IDEAL_GAIN (2.048 / 256 / 3.3 * 1024)  // ADC steps per DAC step
+
+//
+// Running mean and variance (Welford)
+//
+struct welford {
+  long n;
+  double mean, m2;
+  int min, max;
+};
+
+static void welford_add(struct welford *w, int x)
+{ double d;
+  if (w->n == 0 || x < w->min) w->min = x;
+  if (w->n == 0 || x > w->max) w->max = x;
+  w->n++;
+  d = x - w->mean;
+  w->mean += d / w->n;
+  w->m2 += d * (x - w->mean);
+} // welford_add
+
+static double welford_sd(struct welford *w)
+{
+  return w->n > 1 ? sqrt(w->m2 / (w->n - 1)) : 0;
+} // welford_sd
+
+//
+// Least squares line y = a + b*x, the same way:
+// running means and co-moments instead of big sums
+//
+struct fit {
+  long n;
+  double mx, my, sxx, sxy;
+};
+
+static void fit_add(struct fit *f, double x, double y)
+{ double dx;
+  f->n++;
+  dx = x - f->mx;
+  f->mx += dx / f->n;
+  f->my += (y - f->my) / f->n;
+  f->sxx += dx * (x - f->mx);
+  f->sxy += dx * (y - f->my);
+} // fit_add
+
+static struct welford step[2][CODES];
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-b] [-d dac_chan] [-a adc_chan] [-n samples] [-s settle_us]\n"
+    "          [-o csv_file]\n"
+    "  -b batch: no wiring help, do not wait for enter\n", prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, batch, dac, adc, n, dir, code, k, i;
+  int buf[MAX_SAMPLE];
+  long settle;
+  unsigned long long t0, t;
+  double gain, offset, y, prev, inl, dnl, inl_max, dnl_max, hyst, hyst_max;
+  double sd_sum;
+  struct fit f;
+  struct welford *w;
+  char *csv = NULL;
+  FILE *fp;
+
+  batch  = 0;
+  dac    = 1;
+  adc    = 0;
+  n      = 16;
+  settle = 20;
+  while ((c = getopt(argc, argv, "bd:a:n:s:o:")) != -1)
+  {
+    switch (c)
+    {
+    case 'b' : batch  = 1; break;
+    case 'd' : dac    = atoi(optarg); break;
+    case 'a' : adc    = atoi(optarg); break;
+    case 'n' : n      = atoi(optarg); break;
+    case 's' : settle = atol(optarg); break;
+    case 'o' : csv    = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind < argc || dac < 0 || dac > 1 || adc < 0 || adc > 1 ||
+      n < 1 || n > MAX_SAMPLE || settle < 0)
+    usage(argv[0]);
+  settle *= 1000; // ns
+
+  fp = stdout;
+  if (csv && (fp = fopen(csv, "w")) == NULL)
+  { printf("Can't open %s\n", csv);
+    exit(EXIT_FAILURE);
+  }
+
+  if (!batch)
+  {
+    printf ("These are the connections for the DAC to ADC characterisation:\n");
+    printf ("jumper connecting GP11 to SCLK\n");
+    printf ("jumper connecting GP10 to MOSI\n");
+    printf ("jumper connecting GP9 to MISO\n");
+    printf ("jumper connecting GP8 to CSnA\n");
+    printf ("jumper connecting GP7 to CSnB\n");
+    printf ("jumper connecting DA%d on J29 to AD%d on J28\n", dac, adc);
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
+
+  // Map the I/O sections
+  setup_io();
+
+  // Optional real-time profile, see gb_rt.c
+  setup_rt_env();
+
+  // activate SPI bus pins
+  setup_gpio();
+
+  // Setup SPI bus
+  setup_spi();
+
+  // start from 0 and give the output time to get there
+  write_dac(dac, 0);
+  wait_until_ns(get_time_ns() + 1000000, 0);
+
+  // up 0..255, then down 255..0
+  memset(step, 0, sizeof(step));
+  t0 = get_time_ns();
+  for (dir = UP; dir <= DOWN; dir++)
+    for (k = 0; k < CODES; k++)
+    {
+      code = dir == UP ? k : CODES-1 - k;
+      write_dac(dac, code * 16);
+      if (settle)
+        wait_until_ns(get_time_ns() + settle, settle);
+      read_adc_block(adc, buf, n);
+      w = &step[dir][code];
+      for (i = 0; i < n; i++)
+        welford_add(w, buf[i]);
+    }
+  t = get_time_ns() - t0;
+  write_dac(dac, 0);
+
+  restore_rt();
+  restore_io();
+
+  // Fit a line through the means of both directions. Codes which
+  // read as 0 are left out: the ADC can not go below 0, so there the
+  // curve is flat whatever the DAC does.
+  memset(&f, 0, sizeof(f));
+  for (code = 0; code < CODES; code++)
+    for (dir = UP; dir <= DOWN; dir++)
+      if (step[dir][code].mean >= 0.5)
+        fit_add(&f, code, step[dir][code].mean);
+  if (f.n < 2 || f.sxx == 0)
+  { printf("Not enough steps above 0, is DA%d connected to AD%d?\n", dac, adc);
+    exit(EXIT_FAILURE);
+  }
+  gain   = f.sxy / f.sxx;
+  offset = f.my - gain * f.mx;
+
+  fprintf(fp, "code,dir,mean,stddev,min,max,ideal,inl,dnl\n");
+  inl_max = dnl_max = hyst_max = sd_sum = 0;
+  for (dir = UP; dir <= DOWN; dir++)
+  {
+    prev = -1;
+    for (code = 0; code < CODES; code++)
+    {
+      w = &step[dir][code];
+      y = w->mean;
+      sd_sum += welford_sd(w);
+      // both in DAC steps
+      inl = y >= 0.5 ? (y - (offset + gain * code)) / gain : 0;
+      dnl = y >= 0.5 && prev >= 0.5 ? (y - prev) / gain - 1 : 0;
+      if (fabs(inl) > inl_max) inl_max = fabs(inl);
+      if (fabs(dnl) > dnl_max) dnl_max = fabs(dnl);
+      fprintf(fp, "%d,%s,%.3f,%.3f,%d,%d,%.3f,%.3f,%.3f\n", code,
+              dir == UP ? "up" : "down", y, welford_sd(w), w->min, w->max,
+              code * IDEAL_GAIN, inl, dnl);
+      prev = y;
+    }
+  }
+  for (code = 0; code < CODES; code++)
+  { hyst = fabs(step[UP][code].mean - step[DOWN][code].mean);
+    if (hyst > hyst_max) hyst_max = hyst;
+  }
+  if (fp != stdout)
+    fclose(fp);
+
+  // the summary starts with # so it does not disturb the CSV on stdout
+  printf("# %d steps x %d samples in %.1f ms (%.0f samples/s)\n",
+         2*CODES, n, t/1e6, 2.0*CODES*n*1e9/t);
+  printf("# gain %.4f ADC steps per DAC step, error %+.2f%%\n",
+         gain, (gain / IDEAL_GAIN - 1) * 100);
+  printf("# offset %+.2f ADC steps\n", offset);
+  printf("# max |INL| %.3f, max |DNL| %.3f DAC steps\n", inl_max, dnl_max);
+  printf("# max hysteresis %.3f ADC steps, avg noise %.3f ADC steps\n",
+         hyst_max, sd_sum / (2*CODES));
+
+  return 0;
+} // main
@@ -0,0 +1,103 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Decode captured GPIO activity
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Run protocol decoders over a capture made with the logic program.
+// This does not need the Gertboard, so you can also run it on a PC.
+//
+// To see what read_adc() puts on the wire:
+//   sudo ./logic -r 2000000 -t 1 -o adc.cap    (while running atod)
+//   ./decode -s 8 adc.cap
+//
+// -u pin:baud   decode a UART (8N1) on a pin, e.g. -u 14:115200
+// -s cs         decode SPI with chip select cs (8=ADC, 7=DAC) on the
+//               Gertboard SPI pins SCLK=11 MOSI=10 MISO=9
+// -p hex_mask   show every pulse on the pins in the mask
+//
+
+#include "gb_capture.h"
+#include "gb_decode.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-u pin:baud] [-s cs] [-p hex_mask] capture_file\n"
+    "  each option at most once\n", prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ struct uart_dec uart;
+  struct spi_dec spi;
+  struct pulse_dec pulse;
+  struct decoder *dec[3];
+  int c, ndec, pin, baud, cs, seen_u, seen_s, seen_p;
+  char *colon;
+
+  // every decoder can be used once, so dec[] can not overflow
+  ndec = seen_u = seen_s = seen_p = 0;
+  while ((c = getopt(argc, argv, "u:s:p:")) != -1)
+  {
+    switch (c)
+    {
+    case 'u' :
+      pin  = atoi(optarg);
+      colon = strchr(optarg, ':');
+      baud = colon ? atoi(colon+1) : 115200;
+      if (seen_u++ || pin < 0 || pin > 31 || baud <= 0)
+        usage(argv[0]);
+      setup_uart_dec(&uart, pin, baud);
+      dec[ndec++] = &uart.dec;
+      break;
+    case 's' :
+      cs = atoi(optarg);
+      if (seen_s++ || cs < 0 || cs > 31)
+        usage(argv[0]);
+      setup_spi_dec(&spi, cs, 11, 10, 9);
+      dec[ndec++] = &spi.dec;
+      break;
+    case 'p' :
+      if (seen_p++)
+        usage(argv[0]);
+      setup_pulse_dec(&pulse, strtoul(optarg, NULL, 16));
+      dec[ndec++] = &pulse.dec;
+      break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc-1 || ndec == 0)
+    usage(argv[0]);
+
+  return decode_capture(argv[optind], dec, ndec) ? EXIT_FAILURE : 0;
+} // main
@@ -27,6 +27,9 @@
 //
 
 #include "gb_common.h"
+#include "gb_edge.h"
+#include "gb_pins.h"
+#include "gb_opts.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -92,10 +95,12 @@ void setup_gpio()
    INP_GPIO(11); OUT_GPIO(11);
 } // setup_gpio
 
-// the led array allows us to select the LED to turn on; for example led[0] is
-// the bit pattern we need to turn on D5, the leftmost LED of the ones
-// we are using (and hence it is the output for 0)
-static int led[] = {1<<11, 1<<10, 1 <<9, 1<<8, 1<<7, 1<<4, 1<<1, 1};
+// the LEDs we use form one 8-bit port; bit 0 is D5, the leftmost LED of
+// the ones we are using (and hence it is the output for 0)
+// The buttons form a 3-bit port. See gb_pins.c
+static const int led_pins[]    = {11, 10, 9, 8, 7, 4, 1, 0};
+static const int button_pins[] = {23, 24, 25};
+static struct pin_group leds, buttons;
 
 // remove pulling on pins so they can be used for somnething else next time
 // gertboard is used
@@ -112,33 +117,39 @@ void unpull_pins()
    GPIO_PULLCLK0 = 0;
 } // unpull_pins
 
-int main(void)
-{ int r,d;
-  unsigned int b,prev_b;
-  char str [4];
-
-  printf ("These are the connections for the buttons test:\n");
-  printf ("GP25 in J2 --- B1 in J3\n");
-  printf ("GP24 in J2 --- B2 in J3\n");
-  printf ("GP23 in J2 --- B3 in J3\n");
-  printf ("GP11 in J2 --- B5 in J3\n");
-  printf ("GP10 in J2 --- B6 in J3\n");
-  printf ("GP9 in J2 --- B7 in J3\n");
-  printf ("GP8 in J2 --- B8 in J3\n");
-  printf ("GP7 in J2 --- B9 in J3\n");
-  printf ("GP4 in J2 --- B10 in J3\n");
-  printf ("GP1 in J2 --- B11 in J3\n");
-  printf ("GP0 in J2 --- B12 in J3\n");
-  printf ("jumper on U4-out-B5\n");
-  printf ("jumper on U4-out-B6\n");
-  printf ("jumper on U4-out-B7\n");
-  printf ("jumper on U4-out-B8\n");
-  printf ("jumper on U5-out-B9\n");
-  printf ("jumper on U5-out-B10\n");
-  printf ("jumper on U5-out-B11\n");
-  printf ("jumper on U5-out-B12\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+int main(int argc, char **argv)
+{ unsigned int b,prev_b;
+  unsigned long long now, deadline;
+  struct gb_opts o;
+
+  // an iteration is one change of the buttons
+  setup_opts(&o, argc, argv, 40, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the buttons test:\n");
+    printf ("GP25 in J2 --- B1 in J3\n");
+    printf ("GP24 in J2 --- B2 in J3\n");
+    printf ("GP23 in J2 --- B3 in J3\n");
+    printf ("GP11 in J2 --- B5 in J3\n");
+    printf ("GP10 in J2 --- B6 in J3\n");
+    printf ("GP9 in J2 --- B7 in J3\n");
+    printf ("GP8 in J2 --- B8 in J3\n");
+    printf ("GP7 in J2 --- B9 in J3\n");
+    printf ("GP4 in J2 --- B10 in J3\n");
+    printf ("GP1 in J2 --- B11 in J3\n");
+    printf ("GP0 in J2 --- B12 in J3\n");
+    printf ("jumper on U4-out-B5\n");
+    printf ("jumper on U4-out-B6\n");
+    printf ("jumper on U4-out-B7\n");
+    printf ("jumper on U4-out-B8\n");
+    printf ("jumper on U5-out-B9\n");
+    printf ("jumper on U5-out-B10\n");
+    printf ("jumper on U5-out-B11\n");
+    printf ("jumper on U5-out-B12\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
    // Map the I/O sections
    setup_io();
@@ -146,6 +157,13 @@ int main(void)
    // Set GPIO pins 23, 24, and 25 to the required mode
    setup_gpio();
 
+   // let the kernel wake us up when one of the inputs changes
+   // instead of reading GPIO_IN0 as fast as we can
+   setup_edge(0x03800000, EDGE_BOTH);
+
+   setup_pin_group(&leds, led_pins, 8);
+   setup_pin_group(&buttons, button_pins, 3);
+
    // read the switches a number of times and light up a different LED
    // to show the result
 
@@ -154,26 +172,35 @@ int main(void)
       all buttons pressed to get this value) */
    prev_b = 0; 
    
-   r = 40; // number of repeats
-
-  while (r)
+  while (next_iteration(&o))
   {
-    b = GPIO_IN0;
-    b = (b >> 23 ) & 0x07; // keep only bits 23, 24 & 25
-    if (b^prev_b)
-    { // one or more buttons changed
-      GPIO_CLR0 = led[prev_b];  // turn off LED for prev button setup
-      GPIO_SET0 = led[b];  // turn on LED for this setup
-      prev_b = b;
-      r--;
-    } // change
+    // sleep until the next edge on bits 23, 24 & 25
+    // until one or more buttons changed
+    deadline = opts_deadline(&o);
+    while ((b = read_pin_group(&buttons)) == prev_b) // bits 23, 24 & 25
+    { now = get_time_ns();
+      if (deadline && now >= deadline)
+        break;
+      if (edge_ready())
+        (void) wait_edge(opts_timeout_ms(&o), NULL, NULL, NULL);
+      else // no edge interface: look again in 5ms
+        wait_until_ns(deadline && now + 5000000 > deadline ?
+                      deadline : now + 5000000, 0);
+    }
+    if (b == prev_b)
+      break; // -t is over
+    // turn off LED for prev button setup and on for this setup
+    write_pin_group(&leds, 1 << b);
+    prev_b = b;
   } // while
 
   // turn off all LEDs
-  for (b = 0; b < 8; b++)
-    GPIO_CLR0 = led[b]; 
+  write_pin_group(&leds, 0);
   // disable pull up on pins & unmap gpio
+  print_edge_stats();
+  restore_edge();
   unpull_pins();
+  print_summary(&o);
   restore_io();
 
   return 0;
@@ -0,0 +1,128 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Dim all 12 LEDs with binary code modulation
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// leds can only switch the LEDs fully on or off. This program gives
+// every LED its own brightness (0..255) and lets a wave of light run
+// over them. One thread does all 12 LEDs, see gb_bcm.c.
+//
+
+#include "gb_common.h"
+#include "gb_bcm.h"
+#include "gb_rt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// dim test GPIO mapping: the same as for the leds test
+//         Function            Mode
+// GPIO7=  LED                 Output
+// GPIO8=  LED                 Output
+// GPIO9=  LED                 Output
+// GPIO10= LED                 Output
+// GPIO11= LED                 Output
+// GPIO17= LED                 Output
+// GPIO18= LED                 Output
+// GPIO21= LED                 Output
+// GPIO22= LED                 Output
+// GPIO23= LED                 Output
+// GPIO24= LED                 Output
+// GPIO25= LED                 Output
+
+// LED L1 .. L12, see leds.c
+static int led_pin[12] = { 25, 24, 23, 22, 21, 18, 17, 11, 10, 9, 8, 7 };
+
+void setup_gpio(void)
+{ int i;
+  for (i = 0; i < 12; i++)
+  { INP_GPIO(led_pin[i]);  OUT_GPIO(led_pin[i]);
+  }
+} // setup_gpio
+
+int main(void)
+{ int i, frame, pos, d, lvl;
+  unsigned long long t;
+
+  printf ("These are the connections for the LED dimming test:\n");
+  printf ("(the same as for the leds test)\n");
+  printf ("jumpers in every out location (U3-out-B1, U3-out-B2, etc)\n");
+  printf ("GP25 in J2 --- B1 in J3\n");
+  printf ("GP24 in J2 --- B2 in J3\n");
+  printf ("GP23 in J2 --- B3 in J3\n");
+  printf ("GP22 in J2 --- B4 in J3\n");
+  printf ("GP21 in J2 --- B5 in J3\n");
+  printf ("GP18 in J2 --- B6 in J3\n");
+  printf ("GP17 in J2 --- B7 in J3\n");
+  printf ("GP11 in J2 --- B8 in J3\n");
+  printf ("GP10 in J2 --- B9 in J3\n");
+  printf ("GP9 in J2 --- B10 in J3\n");
+  printf ("GP8 in J2 --- B11 in J3\n");
+  printf ("GP7 in J2 --- B12 in J3\n");
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  // Set 12 GPIO pins to output mode
+  setup_gpio();
+
+  // Optional real-time profile, see gb_rt.c. The thread of start_bcm()
+  // inherits it: without it the 20us slots of the low bits are
+  // stretched every time something else runs.
+  setup_rt_env();
+
+  // 20us shortest slot: 5.1ms per frame
+  if (start_bcm(led_pin, 12, 20000))
+  { restore_rt();
+    restore_io();
+    return 1;
+  }
+
+  // a bright spot with a tail runs up and down the LEDs
+  // 500 steps of 20ms = 10 seconds
+  t = get_time_ns();
+  for (frame = 0; frame < 500; frame++)
+  { pos = frame % 44;         // 0..43, folded to 0..22 half LEDs
+    if (pos >= 22) pos = 44 - pos;  // and back
+    for (i = 0; i < 12; i++)
+    { d = abs(i*2 - pos);     // distance in half LEDs
+      lvl = 255 >> d;         // halve the brightness per half LED
+      set_bcm(i, lvl);
+    }
+    update_bcm();
+    t += 20000000;
+    wait_until_ns(t, 0);
+  }
+
+  stop_bcm();
+  restore_rt();
+  restore_io();
+  return 0;
+} // main
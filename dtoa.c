@@ -30,6 +30,7 @@
 
 #include "gb_common.h"
 #include "gb_spi.h"
+#include "gb_opts.h"
 
 // Set GPIO pins to the right mode
 // DEMO GPIO mapping:
@@ -63,29 +64,51 @@ void setup_gpio()
 } // setup_gpio
 
 
+// Most likely, the DAC you have installed is an 8 bit one, not 12 bit so 
+// it will ignore that last nibble (4 bits) we send down the SPI interface.
+// So the number that we pass to write_dac will need to be the number
+// want to set (between 0 and 255) multiplied by 16. In hexidecimal,
+// we just put an extra 0 after the number we want to set.
+// So if we want to set the DAC to 64, this is 0x40, so we send 0x400
+// to write_dac.
+
+// To calculate the voltage we get out, we use this formula from the
+// datasheet: V_out = (d / 256) * 2.048
+#define N_LEVELS 5
+static const int level[N_LEVELS] = {
+  0x000,  // V_out = 0 / 256 * 2.048 (gives 0)
+  0x400,  // V_out = 64 / 256 * 2.048 (gives 0.512)
+  0x7F0,  // V_out = 127 / 256 * 2.048 (gives 1.016)
+  0xAA0,  // V_out = 170 / 256 * 2.048 (gives 1.36)
+  0xFF0   // V_out = 255 / 256 * 2.048 (gives 2.04)
+};
+static const char *volts[N_LEVELS] = { "0V", "0.5V", "1.02V", "1.36V", "2.04V" };
+
 //
-//  Read ADC input 0 and show as horizontal bar
+//  Step the DAC through the levels, wait for the user to check
+//  every one with a meter (with -b just keep writing them)
 //
-void main(void)
-{ int d, chan, dummy;
+void main(int argc, char **argv)
+{ int d, chan, step;
+  struct gb_opts o;
 
-  do {
-    printf ("Which channel do you want to test? Type 0 or 1.\n");
-    chan  = (int) getchar();
-    (void) getchar(); // eat carriage return
-  } while (chan != '0' && chan != '1');
-  chan = chan - '0';
+  setup_opts(&o, argc, argv, N_LEVELS, 0, 1);
+  chan = opts_channel(&o, "Which channel do you want to test? Type 0 or 1.",
+                      0, 1);
 
-  printf ("These are the connections for the digital to analogue test:\n");
-  printf ("jumper connecting GP11 to SCLK\n");
-  printf ("jumper connecting GP10 to MOSI\n");
-  printf ("jumper connecting GP9 to MISO\n");
-  printf ("jumper connecting GP7 to CSnB\n");
-  printf ("Multimeter connections (set your meter to read V DC):\n");
-  printf ("  connect black probe to GND\n");
-  printf ("  connect red probe to DA%d on J29\n", chan);
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+  if (!o.batch)
+  {
+    printf ("These are the connections for the digital to analogue test:\n");
+    printf ("jumper connecting GP11 to SCLK\n");
+    printf ("jumper connecting GP10 to MOSI\n");
+    printf ("jumper connecting GP9 to MISO\n");
+    printf ("jumper connecting GP7 to CSnB\n");
+    printf ("Multimeter connections (set your meter to read V DC):\n");
+    printf ("  connect black probe to GND\n");
+    printf ("  connect red probe to DA%d on J29\n", chan);
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
@@ -96,51 +119,19 @@ void main(void)
   // Setup SPI bus
   setup_spi();
 
-  // Most likely, the DAC you have installed is an 8 bit one, not 12 bit so 
-  // it will ignore that last nibble (4 bits) we send down the SPI interface.
-  // So the number that we pass to write_dac will need to be the number
-  // want to set (between 0 and 255) multiplied by 16. In hexidecimal,
-  // we just put an extra 0 after the number we want to set.
-  // So if we want to set the DAC to 64, this is 0x40, so we send 0x400
-  // to write_dac.
-
-  // To calculate the voltage we get out, we use this formula from the
-  // datasheet: V_out = (d / 256) * 2.048
+  step = 0;
+  while (next_iteration(&o))
+  {
+    d = level[step];
+    write_dac(chan, d);
+    if (!o.batch)
+    { printf ("Your meter should read about %s\n", volts[step]);
+      printf ("When ready hit enter.\n");
+      (void) getchar();
+    }
+    step = (step + 1) % N_LEVELS;
+  }
 
-  d = 0x000;
-  write_dac(chan, d);
-  // V_out = 0 / 256 * 2.048 (gives 0)
-  printf ("Your meter should read about 0V\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
-  
-  d = 0x400;
-  write_dac(chan, d);
-  // V_out = 64 / 256 * 2.048 (gives 0.512)
-  printf ("Your meter should read about 0.5V\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
-  
-  d = 0x7F0;
-  write_dac(chan, d);
-  // V_out = 127 / 256 * 2.048 (gives 1.016)
-  printf ("Your meter should read about 1.02V\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
-  
-  d = 0xAA0;
-  write_dac(chan, d);
-  // V_out = 170 / 256 * 2.048 (gives 1.36)
-  printf ("Your meter should read about 1.36V\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
-  
-  d = 0xFF0;
-  write_dac(chan, d);
-  // V_out = 255 / 256 * 2.048 (gives 2.04)
-  printf ("Your meter should read about 2.04V\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
-  
+  print_summary(&o);
   restore_io();
 } // main
@@ -0,0 +1,164 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Binary code modulation for dimming many LEDs from one thread
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// With PWM every LED needs its own timer. Binary code modulation (BCM)
+// splits a frame into 8 slots, one per bit of the brightness: slot 0 is
+// 1 unit long, slot 1 is 2 units, ... slot 7 is 128 units. During slot
+// b an LED is on if bit b of its brightness is set. Over a frame of 255
+// units the LED is on for exactly 'brightness' units.
+//
+// For every slot we work out in advance which GPIOs must be on (set
+// mask) and off (clear mask). The thread then does just two register
+// writes per slot, however many LEDs there are, so 12 LEDs cost the
+// same as 1.
+//
+// With a 20us unit a frame is 5.1ms (about 200Hz, no visible flicker).
+// Slots are timed with absolute deadlines so the frame rate is exact.
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_bcm.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// Two sets of masks: the thread shows one while
+// set_bcm() / update_bcm() fill in the other
+static unsigned set_mask[2][BCM_BITS], clr_mask[2][BCM_BITS];
+static int shown;        // which set the thread uses
+static int pending;      // 1: the other set is newer, swap at frame start
+
+static int bcm_pin[BCM_MAXPIN];
+static unsigned char level[BCM_MAXPIN];
+static int bcm_npins;
+static unsigned long bcm_slot;
+static pthread_t bcm_thread;
+static int bcm_running;
+
+static void *bcm_run(void *arg)
+{ unsigned long long t;
+  int b, s;
+
+  t = get_time_ns();
+  while (1)
+  { // only switch masks between frames
+    if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE))
+    { shown ^= 1;
+      __atomic_store_n(&pending, 0, __ATOMIC_RELEASE);
+    }
+    s = shown;
+    for (b = 0; b < BCM_BITS; b++)
+    { GPIO_SET0 = set_mask[s][b];
+      GPIO_CLR0 = clr_mask[s][b];
+      t += bcm_slot << b;
+      // spin the short slots, sleep most of the long ones
+      wait_until_ns(t, 100000);
+    }
+  }
+  return NULL;
+} // bcm_run
+
+//
+// Work out the masks for every bit plane from the levels
+// and hand them over to the thread at the next frame
+//
+void update_bcm()
+{ unsigned set, all;
+  int b, i, s;
+
+  // wait until the thread took the previous update
+  while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE))
+    wait_until_ns(get_time_ns() + bcm_slot, 0);
+
+  s = shown ^ 1;
+  all = 0;
+  for (i = 0; i < bcm_npins; i++)
+    all |= 1 << bcm_pin[i];
+  for (b = 0; b < BCM_BITS; b++)
+  { set = 0;
+    for (i = 0; i < bcm_npins; i++)
+      if (level[i] & (1<<b))
+        set |= 1 << bcm_pin[i];
+    set_mask[s][b] = set;
+    clr_mask[s][b] = all & ~set;
+  }
+  __atomic_store_n(&pending, 1, __ATOMIC_RELEASE);
+} // update_bcm
+
+//
+// Set the brightness (0..255) of channel 'chan' (index in the pin list).
+// Takes effect at the next update_bcm(). Set all channels, then update.
+//
+void set_bcm(int chan, int lvl)
+{
+  if (chan < 0 || chan >= bcm_npins)
+    return;
+  if (lvl < 0) lvl = 0;
+  if (lvl > 255) lvl = 255;
+  level[chan] = lvl;
+} // set_bcm
+
+//
+// Start dimming 'npins' GPIOs (which must be outputs already)
+// slot : length of the shortest slot in ns
+// All channels start at brightness 0.
+// Returns 0 on success
+//
+int start_bcm(const int *pins, int npins, unsigned long slot)
+{
+  if (npins > BCM_MAXPIN || bcm_running)
+    return -1;
+  memcpy(bcm_pin, pins, npins * sizeof(int));
+  memset(level, 0, sizeof(level));
+  bcm_npins = npins;
+  bcm_slot  = slot;
+  shown = pending = 0;
+  update_bcm();
+  if (pthread_create(&bcm_thread, NULL, bcm_run, NULL))
+  { printf("Can't start the dimming thread\n");
+    return -1;
+  }
+  bcm_running = 1;
+  return 0;
+} // start_bcm
+
+void stop_bcm()
+{ int i;
+  unsigned all;
+
+  if (!bcm_running)
+    return;
+  pthread_cancel(bcm_thread);
+  pthread_join(bcm_thread, NULL);
+  bcm_running = 0;
+  all = 0;
+  for (i = 0; i < bcm_npins; i++)
+    all |= 1 << bcm_pin[i];
+  GPIO_CLR0 = all;
+} // stop_bcm
@@ -0,0 +1,33 @@
+//
+// Gertboard test suite
+//
+// binary code modulation (LED dimming) header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+#define BCM_BITS   8   // brightness 0..255
+#define BCM_MAXPIN 32
+
+int  start_bcm(const int *pins, int npins, unsigned long slot);
+void set_bcm(int chan, int level);
+void update_bcm();
+void stop_bcm();
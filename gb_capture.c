@@ -0,0 +1,292 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Logic analyser: run-length compressed GPIO_IN0 capture
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A sampler thread reads GPIO_IN0 at a fixed rate. Most of the time
+// nothing changes, so instead of storing every sample we only store a
+// record when the (masked) input word changes: how many samples since
+// the last change and the new word. A quiet bus costs nothing, a busy
+// bus costs 8 bytes per change.
+//
+// The sampler must never wait for the disk. It puts the records in a
+// ring buffer, and a second thread writes them to the file. If the
+// writer can't keep up, a change waits (and is counted) until there
+// is room again, so the time stamps of the changes which were stored
+// stay right.
+//
+// Samples are numbered by their time slot, not by how often we managed
+// to read the input. If the thread is late (preempted, interrupt) the
+// missed slots are counted and the time stamps stay correct.
+//
+// Compile with -pthread
+//
+
+// captures can be bigger than 2GB, also on a 32-bit Raspberry Pi
+#define _FILE_OFFSET_BITS 64
+
+#include "gb_common.h"
+#include "gb_capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REC_RING (64*1024)  // records, must be a power of 2
+
+static struct capture_rec rec_ring[REC_RING];
+static unsigned long rec_head, rec_tail;  // sampler writes head, writer tail
+
+static FILE *cap_fp;
+static pthread_t sampler_thread, writer_thread;
+static volatile int capturing;
+static unsigned cap_mask;
+static unsigned first_word;  // the word in the header, sample 0
+static unsigned long cap_period;
+static struct capture_stats stats;
+
+//
+// Store one record. Returns 0 if the ring is full: the record is
+// counted as dropped and the caller has to try again later.
+//
+static int put_rec(unsigned delta, unsigned word)
+{ unsigned long h;
+  h = rec_head;
+  if (h - __atomic_load_n(&rec_tail, __ATOMIC_ACQUIRE) >= REC_RING)
+  { stats.dropped++;
+    return 0;
+  }
+  rec_ring[h & (REC_RING-1)].delta = delta;
+  rec_ring[h & (REC_RING-1)].word  = word;
+  __atomic_store_n(&rec_head, h+1, __ATOMIC_RELEASE);
+  stats.records++;
+  return 1;
+} // put_rec
+
+static void *sample_thread(void *arg)
+{ unsigned long long t0, now, slot, last_slot, last_change, d;
+  unsigned word, prev;
+
+  // start from the word in the header: a pin which changes after
+  // that read is then stored as a change, not lost
+  t0 = get_time_ns();
+  prev = first_word;
+  last_slot = last_change = 0;
+  while (capturing)
+  { // spin until the next slot
+    do {
+      now = get_time_ns();
+      slot = (now - t0) / cap_period;
+    } while (slot == last_slot);
+    stats.missed += slot - last_slot - 1;
+    last_slot = slot;
+    stats.samples++;
+
+    // If the ring is full the change is not stored and prev and
+    // last_change stay as they are, so we try again in the next slot.
+    // The change then shows up a little late, but every record
+    // still counts from the one before it.
+    word = GPIO_IN0 & cap_mask;
+    if (word != prev)
+    { d = slot - last_change;
+      while (d > 0xFFFFFFFFULL && put_rec(0xFFFFFFFF, prev))
+      { // too long for one record: repeat the old word
+        last_change += 0xFFFFFFFF;
+        d -= 0xFFFFFFFF;
+      }
+      if (d <= 0xFFFFFFFFULL && put_rec((unsigned)d, word))
+      { prev = word;
+        last_change = slot;
+      }
+    }
+  }
+  stats.ns = get_time_ns() - t0;
+  return NULL;
+} // sample_thread
+
+static void flush_recs()
+{ unsigned long h, t, n;
+  h = __atomic_load_n(&rec_head, __ATOMIC_ACQUIRE);
+  t = rec_tail;
+  while (t != h)
+  { // write in at most two pieces (ring wraps)
+    n = REC_RING - (t & (REC_RING-1));
+    if (n > h - t)
+      n = h - t;
+    fwrite(&rec_ring[t & (REC_RING-1)], sizeof(struct capture_rec), n, cap_fp);
+    t += n;
+    __atomic_store_n(&rec_tail, t, __ATOMIC_RELEASE);
+  }
+} // flush_recs
+
+static void *write_thread(void *arg)
+{ struct timespec ts = { 0, 10000000 };  // 10ms
+  while (capturing)
+  { flush_recs();
+    nanosleep(&ts, NULL);
+  }
+  return NULL;
+} // write_thread
+
+//
+// Start the sampler thread, with SCHED_FIFO priority 'prio' if not 0
+// Returns 0 on success
+//
+static int start_sampler(int prio)
+{ pthread_attr_t attr;
+  struct sched_param sp;
+  int err;
+
+  if (!prio)
+    return pthread_create(&sampler_thread, NULL, sample_thread, NULL);
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  memset(&sp, 0, sizeof(sp));
+  sp.sched_priority = prio;
+  pthread_attr_setschedparam(&attr, &sp);
+  err = pthread_create(&sampler_thread, &attr, sample_thread, NULL);
+  pthread_attr_destroy(&attr);
+  if (err)
+  { printf("start_capture: can't set SCHED_FIFO priority %d (%s)\n",
+           prio, strerror(err));
+    err = pthread_create(&sampler_thread, NULL, sample_thread, NULL);
+  }
+  return err;
+} // start_sampler
+
+//
+// Start capturing the pins in 'mask' every 'period' ns into 'file'
+// prio: SCHED_FIFO priority of the sampler thread only, 0 for none.
+//       The sampler never sleeps, so the writer thread and the caller
+//       must run at a higher priority (or not real-time at all) or on
+//       a single core they never get the CPU back.
+// Returns 0 on success
+//
+int start_capture(const char *file, unsigned mask, unsigned long period,
+                  int prio)
+{ struct capture_header hdr;
+
+  if ((cap_fp = fopen(file, "wb")) == NULL)
+  { printf("Can't open %s\n", file);
+    return -1;
+  }
+  memset(&stats, 0, sizeof(stats));
+  rec_head = rec_tail = 0;
+  cap_mask = mask;
+  cap_period = period ? period : 1;
+
+  hdr.magic  = CAPTURE_MAGIC;
+  hdr.period = cap_period;
+  hdr.mask   = mask;
+  hdr.first  = first_word = GPIO_IN0 & mask;
+  fwrite(&hdr, sizeof(hdr), 1, cap_fp);
+
+  capturing = 1;
+  if (pthread_create(&writer_thread, NULL, write_thread, NULL) ||
+      start_sampler(prio))
+  { printf("Can't start the capture threads\n");
+    capturing = 0;
+    fclose(cap_fp);
+    return -1;
+  }
+  return 0;
+} // start_capture
+
+//
+// Stop the capture, write what is left and close the file
+//
+void stop_capture(struct capture_stats *st)
+{
+  capturing = 0;
+  pthread_join(sampler_thread, NULL);
+  pthread_join(writer_thread, NULL);
+  flush_recs();
+  fclose(cap_fp);
+  if (st)
+    *st = stats;
+} // stop_capture
+
+//
+// Convert a capture file to a Value Change Dump which any waveform
+// viewer (e.g. GTKWave) can show. Works on one record at a time
+// so the size of the capture does not matter.
+// Returns 0 on success
+//
+int capture_to_vcd(const char *capfile, const char *vcdfile)
+{ struct capture_header hdr;
+  struct capture_rec rec;
+  unsigned long long t;
+  unsigned prev, chg;
+  FILE *in, *out;
+  int g;
+
+  if ((in = fopen(capfile, "rb")) == NULL)
+  { printf("Can't open %s\n", capfile);
+    return -1;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, in) != 1 || hdr.magic != CAPTURE_MAGIC)
+  { printf("%s is not a capture file\n", capfile);
+    fclose(in);
+    return -1;
+  }
+  if ((out = fopen(vcdfile, "w")) == NULL)
+  { printf("Can't open %s\n", vcdfile);
+    fclose(in);
+    return -1;
+  }
+
+  // One signal per captured GPIO, identifier is a single
+  // printable character: '!' + GPIO number
+  fprintf(out, "$timescale 1ns $end\n$scope module gertboard $end\n");
+  for (g = 0; g < 32; g++)
+    if (hdr.mask & (1<<g))
+      fprintf(out, "$var wire 1 %c GPIO%d $end\n", '!'+g, g);
+  fprintf(out, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+  for (g = 0; g < 32; g++)
+    if (hdr.mask & (1<<g))
+      fprintf(out, "%d%c\n", (hdr.first>>g)&1, '!'+g);
+  fprintf(out, "$end\n");
+
+  t = 0;
+  prev = hdr.first;
+  while (fread(&rec, sizeof(rec), 1, in) == 1)
+  { t += rec.delta;
+    chg = rec.word ^ prev;
+    if (!chg)
+      continue;
+    fprintf(out, "#%llu\n", t * hdr.period);
+    for (g = 0; g < 32; g++)
+      if (chg & (1<<g))
+        fprintf(out, "%d%c\n", (rec.word>>g)&1, '!'+g);
+    prev = rec.word;
+  }
+  fclose(in);
+  fclose(out);
+  return 0;
+} // capture_to_vcd
@@ -0,0 +1,57 @@
+//
+// Gertboard test suite
+//
+// logic analyser capture header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// A capture file starts with this header,
+// followed by capture_rec records until the end of the file.
+#define CAPTURE_MAGIC 0x414C4247  // "GBLA"
+
+struct capture_header {
+  unsigned magic;
+  unsigned period;   // sample period in ns
+  unsigned mask;     // pins which were captured
+  unsigned first;    // GPIO_IN0 (masked) at sample 0
+};
+
+// The input word changed to 'word' 'delta' samples after the previous
+// record. A record with an unchanged word is only used when the delta
+// would not fit in 32 bits.
+struct capture_rec {
+  unsigned delta;
+  unsigned word;
+};
+
+struct capture_stats {
+  unsigned long long samples;  // number of samples taken
+  unsigned long long records;  // number of changes stored
+  unsigned long long missed;   // sample slots we were too late for
+  unsigned long long dropped;  // slots a change waited for room (disk too slow)
+  unsigned long long ns;       // duration of the capture
+};
+
+int  start_capture(const char *file, unsigned mask, unsigned long period,
+                   int prio);
+void stop_capture(struct capture_stats *st);
+int  capture_to_vcd(const char *capfile, const char *vcdfile);
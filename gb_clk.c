@@ -0,0 +1,157 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Clock manager: PWM clock and general purpose clocks
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Each clock of the clock manager takes a source (normally the 19.2MHz
+// crystal or the 500MHz PLLD) and divides it by DIVI + DIVF/4096.
+// With MASH 0 only DIVI is used and the output is a clean clock.
+// With MASH 1, 2 or 3 the fraction is made by switching between
+// nearby dividers. The average frequency is right, the individual
+// periods jitter (more for a higher MASH order, but the noise moves
+// up in frequency).
+//
+// The GPCLKs can be put on a pin. GPCLK0 comes out on GPIO4 (GP4 in
+// J2 of the Gertboard) so you can clock an external chip without
+// using any CPU time at all.
+//
+// Every write needs the password in the top byte. The divider may
+// only be changed while the clock generator is stopped: first clear
+// ENAB and wait for BUSY to go away, otherwise the clock manager can
+// lock up or glitch.
+//
+
+#include "gb_common.h"
+#include "gb_clk.h"
+
+// control register of each clock, the divider register is next to it
+static const int clk_reg[4] = {28, 30, 32, 40};
+
+// MASH n needs an integer part of at least this
+static const unsigned mash_min_divi[4] = {1, 2, 3, 5};
+
+//
+// Work out the divider for a clock of hz from a source of src_hz
+// mash: 0 integer only, 1-3 fractional, -1 integer if that is within
+// 0.1% otherwise MASH 1
+// Returns the MASH mode to use, or -1 if hz can not be made
+//
+int clock_divider(double src_hz, double hz, int mash,
+                  unsigned *divi, unsigned *divf)
+{ double d, f;
+
+  if (hz <= 0 || mash > 3)
+    return -1;
+  d = src_hz / hz;
+  if (mash <= 0)
+  { *divi = (unsigned)(d + 0.5);
+    *divf = 0;
+    if (*divi >= 1 && *divi <= 4095)
+    { f = src_hz / *divi;
+      if (mash == 0 || (f - hz <= hz / 1000 && hz - f <= hz / 1000))
+        return 0;
+    }
+    if (mash == 0)
+      return -1;
+    mash = 1;
+  }
+  *divi = (unsigned)d;
+  *divf = (unsigned)((d - *divi) * 4096 + 0.5);
+  if (*divf > 4095)
+  { (*divi)++;
+    *divf = 0;
+  }
+  if (*divi < mash_min_divi[mash] || *divi > 4095)
+    return -1;
+  return *divf ? mash : 0;
+} // clock_divider
+
+//
+// Stop a clock and wait until it has really stopped
+//
+void stop_clock(int clock)
+{ volatile unsigned *ctl;
+  unsigned long long t0;
+
+  ctl = clk + clk_reg[clock & 3];
+  *ctl = CLK_PASSWD | (*ctl & 0x70F & ~CLK_ENAB);
+  t0 = get_time_ns();
+  while (*ctl & CLK_BUSY)
+    if (get_time_ns() - t0 > 10000000)
+    { // does not stop by itself
+      *ctl = CLK_PASSWD | CLK_KILL | (*ctl & 0x70F);
+      short_wait();
+      break;
+    }
+} // stop_clock
+
+//
+// (Re)start a clock with a given source and divider
+//
+void start_clock(int clock, int src, unsigned divi, unsigned divf, int mash)
+{ volatile unsigned *ctl;
+
+  clock &= 3;
+  ctl = clk + clk_reg[clock];
+  stop_clock(clock);
+  *(ctl+1) = CLK_PASSWD | ((divi & 0xFFF)<<12) | (divf & 0xFFF);
+  *ctl = CLK_PASSWD | CLK_MASH(mash) | (src & 0xF);
+  *ctl = CLK_PASSWD | CLK_MASH(mash) | (src & 0xF) | CLK_ENAB;
+} // start_clock
+
+//
+// Start a clock as close as possible to hz
+// src: CLK_SRC_OSC, CLK_SRC_PLLD or CLK_SRC_AUTO (whichever is closer,
+//      the crystal if they are the same)
+// mash: as for clock_divider
+// Returns the (average) frequency obtained, 0 if hz can not be made
+//
+double setup_clock(int clock, int src, double hz, int mash)
+{ unsigned divi, divf, pdivi, pdivf;
+  int m, pm, any;
+  double f, pf;
+
+  any = src == CLK_SRC_AUTO;
+  f = 0;
+  m = -1;
+  divi = divf = 0;
+  if (src == CLK_SRC_OSC || any)
+  { if ((m = clock_divider(CLK_OSC_HZ, hz, mash, &divi, &divf)) >= 0)
+      f = CLK_OSC_HZ / (divi + divf/4096.0);
+    src = CLK_SRC_OSC;
+  }
+  // a clean integer divider of the crystal is as good as it gets
+  if (src == CLK_SRC_PLLD || (any && m != 0))
+  { pm = clock_divider(CLK_PLLD_HZ, hz, mash, &pdivi, &pdivf);
+    pf = pm >= 0 ? CLK_PLLD_HZ / (pdivi + pdivf/4096.0) : 0;
+    if (pm >= 0 && (m < 0 || (pf-hz)*(pf-hz) < (f-hz)*(f-hz)))
+    { src = CLK_SRC_PLLD;
+      m = pm; f = pf; divi = pdivi; divf = pdivf;
+    }
+  }
+  if (m < 0)
+    return 0;
+  start_clock(clock, src, divi, divf, m);
+  return f;
+} // setup_clock
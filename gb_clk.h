@@ -0,0 +1,62 @@
+//
+// Gertboard test suite
+//
+// clock manager header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// Clock manager registers, two per clock: control and divider
+#define CM_GP0CTL   *(clk+28)
+#define CM_GP0DIV   *(clk+29)
+#define CM_GP1CTL   *(clk+30)
+#define CM_GP1DIV   *(clk+31)
+#define CM_GP2CTL   *(clk+32)
+#define CM_GP2DIV   *(clk+33)
+#define CM_PWMCTL   *(clk+40)
+#define CM_PWMDIV   *(clk+41)
+
+// Clock manager bits
+#define CLK_PASSWD      0x5A000000 // must be in every write
+#define CLK_MASH(n)     ((n)<<9)   // 0 = integer divider, 1-3 = fractional
+#define CLK_BUSY        0x00000080 // clock generator is running
+#define CLK_KILL        0x00000020 // stop the clock generator
+#define CLK_ENAB        0x00000010 // start the clock generator
+
+// Clock sources
+#define CLK_SRC_AUTO    -1         // setup_clock picks OSC or PLLD
+#define CLK_SRC_GND     0
+#define CLK_SRC_OSC     1          // crystal oscillator
+#define CLK_SRC_PLLD    6
+#define CLK_OSC_HZ      19200000
+#define CLK_PLLD_HZ     500000000
+
+// The clocks we can drive
+#define CLK_GP0         0          // GPCLK0, GPIO4 Alt0 (GP4 in J2)
+#define CLK_GP1         1          // GPCLK1, GPIO5 Alt0
+#define CLK_GP2         2          // GPCLK2, GPIO6 Alt0
+#define CLK_PWM         3          // PWM clock
+
+int    clock_divider(double src_hz, double hz, int mash,
+                     unsigned *divi, unsigned *divf);
+void   start_clock(int clock, int src, unsigned divi, unsigned divf, int mash);
+void   stop_clock(int clock);
+double setup_clock(int clock, int src, double hz, int mash);
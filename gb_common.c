@@ -54,6 +54,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <errno.h>
+#include <time.h>
 #include <unistd.h>
 
 #define PAGE_SIZE (4*1024)
@@ -128,6 +130,68 @@ void long_wait(int v)
     }
 } // long_wait
 
+//
+// Read the monotonic clock in nanoseconds.
+// Unlike the wait loops above this does not depend
+// on the CPU speed or the compiler optimisation level.
+//
+unsigned long long get_time_ns()
+{ struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+} // get_time_ns
+
+//
+// Wait until an absolute deadline (as returned by get_time_ns).
+// Sleep in the kernel until 'spin' ns before the deadline
+// then busy-wait the rest. The kernel wakes us up late by
+// some amount (scheduler latency), the final spin hides that.
+// spin=0 : sleep only, a spin larger than the period: busy-wait only
+//
+void wait_until_ns(unsigned long long deadline, unsigned long spin)
+{ struct timespec ts;
+  unsigned long long wake;
+
+  if (deadline > spin)
+  { wake = deadline - spin;
+    if (get_time_ns() < wake)
+    { ts.tv_sec  = wake / 1000000000ULL;
+      ts.tv_nsec = wake % 1000000000ULL;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)==EINTR)
+        ;
+    }
+  }
+  while (get_time_ns() < deadline)
+    ;
+} // wait_until_ns
+
+//
+// Collect a value in a histogram of HIST_BUCKETS buckets,
+// each 'res' ns wide. The last bucket holds everything above.
+//
+void hist_add(unsigned *hist, long v, long res)
+{ long b;
+  b = v / res;
+  if (b < 0) b = 0;
+  if (b >= HIST_BUCKETS) b = HIST_BUCKETS-1;
+  hist[b]++;
+} // hist_add
+
+//
+// Print min/avg/max of n values and their histogram
+//
+void hist_print(const char *title, unsigned *hist, long res,
+                long min, long max, double sum, unsigned long long n)
+{ int b, last;
+
+  printf("%s (ns): min %ld avg %.0f max %ld\n", title, min, sum/n, max);
+  // don't print the empty tail of the histogram
+  for (last = HIST_BUCKETS-1; last > 0 && hist[last]==0; last--)
+    ;
+  for (b = 0; b <= last; b++)
+    printf("  %s%7ld %u\n", b==HIST_BUCKETS-1 ? ">=" : "  ", b*res, hist[b]);
+} // hist_print
+
 
 //
 // Set up memory regions to access the peripherals.
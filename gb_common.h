@@ -37,6 +37,16 @@ extern volatile unsigned *uart;
 void short_wait();
 void long_wait(int v);
 
+// Calibrated timing (CLOCK_MONOTONIC, nanoseconds)
+unsigned long long get_time_ns();
+void wait_until_ns(unsigned long long deadline, unsigned long spin);
+
+// Latency histograms
+#define HIST_BUCKETS 100 // the last one holds everything that is too late
+void hist_add(unsigned *hist, long v, long res);
+void hist_print(const char *title, unsigned *hist, long res,
+                long min, long max, double sum, unsigned long long n);
+
 void setup_io();
 void restore_io();
 void make_binary_string(int, int, char *);
@@ -0,0 +1,127 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Bit-sliced debouncing of all input pins
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A mechanical switch does not go from open to closed in one clean step,
+// it bounces for a few milliseconds. Comparing one sample with the
+// previous one (b ^ prev_b) sees every bounce as a button press.
+//
+// Here every pin has a 2-bit counter which counts how many samples in
+// a row have been different from the debounced state. After 4 such
+// samples the pin changes state. Any sample equal to the state resets
+// the counter. Instead of 32 little counters we store bit 0 of all the
+// counters in one word (cnt0) and bit 1 in another (cnt1). Then a
+// handful of AND/XOR operations update all 32 counters at the same time
+// (a "vertical counter"). The cost per sample is the same for 1 or 32
+// pins, so this can run inside a fast sampling loop.
+//
+//   sample every 5ms -> a pin must be stable for 20ms to change state
+//
+
+#include "gb_common.h"
+#include "gb_edge.h"
+#include "gb_debounce.h"
+
+//
+// Start debouncing with the current pin levels as stable state
+// mask   : pins to debounce
+// invert : pins which read 0 when active (e.g. buttons with pull-ups)
+//
+void setup_debounce(struct debounce *d, unsigned mask, unsigned invert)
+{
+  d->mask   = mask;
+  d->invert = invert;
+  d->cnt0   = 0;
+  d->cnt1   = 0;
+  d->state  = (GPIO_IN0 ^ invert) & mask;
+} // setup_debounce
+
+//
+// Feed one GPIO_IN0 sample through the debouncer
+// press   : pins which became active with this sample (may be NULL)
+// release : pins which became inactive with this sample (may be NULL)
+// Returns the pins which changed state
+//
+unsigned debounce(struct debounce *d, unsigned sample,
+                  unsigned *press, unsigned *release)
+{ unsigned delta, toggle;
+
+  delta   = ((sample ^ d->invert) & d->mask) ^ d->state;
+  // count up where the sample differs, reset to 0 where it does not
+  d->cnt1 = (d->cnt1 ^ d->cnt0) & delta;
+  d->cnt0 = ~d->cnt0 & delta;
+  // counter wrapped from 3 to 0 while still different: change state
+  toggle  = delta & ~(d->cnt0 | d->cnt1);
+  d->state ^= toggle;
+
+  if (press)   *press   = toggle & d->state;
+  if (release) *release = toggle & ~d->state;
+  return toggle;
+} // debounce
+
+//
+// Sample GPIO_IN0 every 'period' ns until a debounced change comes out.
+// When all pins are stable and setup_edge() was done for the pins,
+// sleep until the next edge instead of sampling.
+// Returns the pins which changed state
+//
+unsigned wait_debounced(struct debounce *d, unsigned long period,
+                        unsigned *press, unsigned *release)
+{
+  return wait_debounced_until(d, period, 0, press, release);
+} // wait_debounced
+
+//
+// The same, but give up at 'deadline' (get_time_ns, 0: never)
+// Returns the pins which changed state, 0 if the time was up
+//
+unsigned wait_debounced_until(struct debounce *d, unsigned long period,
+                              unsigned long long deadline,
+                              unsigned *press, unsigned *release)
+{ unsigned long long next, now;
+  unsigned sample, toggle;
+  int ms;
+
+  next = get_time_ns();
+  while (1)
+  { sample = GPIO_IN0;
+    toggle = debounce(d, sample, press, release);
+    if (toggle)
+      return toggle;
+    now = get_time_ns();
+    if (deadline && now >= deadline)
+      return 0;
+    if (edge_ready() && ((sample ^ d->invert) & d->mask) == d->state)
+    { // nothing going on: sleep until the next edge
+      ms = deadline ? (int)((deadline - now) / 1000000) + 1 : -1;
+      wait_edge(ms, NULL, NULL, NULL);
+      next = get_time_ns();
+    }
+    else
+    { next += period;
+      wait_until_ns(deadline && next > deadline ? deadline : next, 0);
+    }
+  }
+} // wait_debounced_until
@@ -0,0 +1,44 @@
+//
+// Gertboard test suite
+//
+// debounce header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// Debounce state for all 32 pins of GPIO_IN0.
+// Bit n of every field belongs to GPIO n.
+struct debounce {
+  unsigned state;   // debounced level, 1 = active
+  unsigned cnt0;    // low bit of the per-pin sample counters
+  unsigned cnt1;    // high bit of the per-pin sample counters
+  unsigned invert;  // pins which are active low (pull-up buttons)
+  unsigned mask;    // pins we care about
+};
+
+void     setup_debounce(struct debounce *d, unsigned mask, unsigned invert);
+unsigned debounce(struct debounce *d, unsigned sample,
+                  unsigned *press, unsigned *release);
+unsigned wait_debounced(struct debounce *d, unsigned long period,
+                        unsigned *press, unsigned *release);
+unsigned wait_debounced_until(struct debounce *d, unsigned long period,
+                              unsigned long long deadline,
+                              unsigned *press, unsigned *release);
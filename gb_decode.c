@@ -0,0 +1,289 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Offline protocol decoders for captured GPIO streams
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// These decoders work on the change records written by gb_capture.c.
+// decode_capture() reads the file in big blocks and keeps one running
+// time, so a capture of any size is decoded in one pass in little memory.
+//
+// Most records do not touch the pins a decoder looks at (e.g. a UART
+// decoder while the SPI bus is busy). For every record we XOR the new
+// word with the old one and AND it with the pins all decoders need:
+// one test skips the record for all of them. Only when a wanted pin
+// changed are the decoders called, and the pulse decoder walks the
+// changed bits with count-trailing-zeros instead of testing 32 pins.
+//
+// Time stamps are printed in microseconds from the start of the capture.
+// A UART byte is only printed once its stop bit has been sampled, which
+// is at the next change on its pin, so its line may come out after lines
+// of other decoders with a later time stamp. Sort on the first column if
+// you need them in order.
+//
+
+// captures can be bigger than 2GB, also on a 32-bit Raspberry Pi
+#define _FILE_OFFSET_BITS 64
+
+#include "gb_capture.h"
+#include "gb_decode.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define BLOCK_RECS (64*1024)  // records read from the file in one go
+
+//
+// UART
+//
+
+// take all bit samples which fall before time t (the line is at
+// u->level for all of them as nothing changed in between)
+static void uart_run(struct uart_dec *u, unsigned long long t)
+{
+  while (u->next && u->next < t)
+  { if (u->nbit < 8)
+      u->shift |= u->level << u->nbit;  // LSB first
+    else
+    { // stop bit, must be high
+      if (u->level)
+        printf("%12.3f UART GPIO%d 0x%02X '%c'\n", u->start/1e3, u->pin,
+               u->shift, u->shift >= 0x20 && u->shift < 0x7F ? u->shift : '.');
+      else
+      { printf("%12.3f UART GPIO%d framing error\n", u->start/1e3, u->pin);
+        u->errors++;
+      }
+      u->frames++;
+      u->next = 0;
+      return;
+    }
+    u->nbit++;
+    u->next += u->bit_ns;
+  }
+} // uart_run
+
+static void uart_edge(struct decoder *d, unsigned long long t,
+                      unsigned prev, unsigned word)
+{ struct uart_dec *u = (struct uart_dec *)d;
+
+  uart_run(u, t);
+  u->level = (word >> u->pin) & 1;
+  if (!u->next && !u->level)
+  { // start bit: sample the data bits in the middle
+    u->start = t;
+    u->next  = t + u->bit_ns + u->bit_ns/2;
+    u->nbit  = 0;
+    u->shift = 0;
+  }
+} // uart_edge
+
+static void uart_finish(struct decoder *d, unsigned long long t)
+{ struct uart_dec *u = (struct uart_dec *)d;
+  uart_run(u, ~0ULL);
+  printf("UART GPIO%d: %lu frames, %lu framing errors\n",
+         u->pin, u->frames, u->errors);
+} // uart_finish
+
+void setup_uart_dec(struct uart_dec *u, int pin, int baud)
+{
+  memset(u, 0, sizeof(*u));
+  u->dec.mask   = 1<<pin;
+  u->dec.edge   = uart_edge;
+  u->dec.finish = uart_finish;
+  u->pin    = pin;
+  u->bit_ns = 1000000000ULL / baud;
+  u->level  = 1;
+} // setup_uart_dec
+
+//
+// SPI
+//
+
+static void spi_print(struct spi_dec *s)
+{ int i;
+  printf("%12.3f SPI CS%d MOSI:", s->start/1e3, s->cs);
+  for (i = 0; i < s->nbyte; i++)
+    printf(" %02X", s->mosi_buf[i]);
+  printf("  MISO:");
+  for (i = 0; i < s->nbyte; i++)
+    printf(" %02X", s->miso_buf[i]);
+  if (s->nbit)
+    printf("  (+%d bits)", s->nbit);
+  printf("\n");
+  s->transactions++;
+} // spi_print
+
+static void spi_edge(struct decoder *d, unsigned long long t,
+                     unsigned prev, unsigned word)
+{ struct spi_dec *s = (struct spi_dec *)d;
+  unsigned chg = prev ^ word;
+
+  if (chg & (1<<s->cs))
+  { if (!(word & (1<<s->cs)))
+    { // chip select goes low: start of a transaction
+      s->active = 1;
+      s->start  = t;
+      s->nbit = s->nbyte = 0;
+      s->mosi_byte = s->miso_byte = 0;
+    }
+    else if (s->active)
+    { spi_print(s);
+      s->active = 0;
+    }
+  }
+
+  if (s->active && (chg & (1<<s->sclk)) && (word & (1<<s->sclk)))
+  { // rising clock: shift in one bit, MSB first
+    s->mosi_byte = (s->mosi_byte << 1) | ((word >> s->mosi) & 1);
+    s->miso_byte = (s->miso_byte << 1) | ((word >> s->miso) & 1);
+    if (++s->nbit == 8)
+    { if (s->nbyte < (int)sizeof(s->mosi_buf))
+      { s->mosi_buf[s->nbyte] = s->mosi_byte;
+        s->miso_buf[s->nbyte] = s->miso_byte;
+        s->nbyte++;
+      }
+      s->nbit = 0;
+    }
+  }
+} // spi_edge
+
+static void spi_finish(struct decoder *d, unsigned long long t)
+{ struct spi_dec *s = (struct spi_dec *)d;
+  if (s->active)
+    spi_print(s);
+  printf("SPI CS%d: %lu transactions\n", s->cs, s->transactions);
+} // spi_finish
+
+//
+// Set up an SPI decoder. On the Gertboard: cs 8 (ADC) or 7 (DAC),
+// sclk 11, mosi 10, miso 9 (the pins gb_spi.c uses)
+//
+void setup_spi_dec(struct spi_dec *s, int cs, int sclk, int mosi, int miso)
+{
+  memset(s, 0, sizeof(*s));
+  s->dec.mask   = (1<<cs) | (1<<sclk);  // data pins only matter on a clock
+  s->dec.edge   = spi_edge;
+  s->dec.finish = spi_finish;
+  s->cs = cs;  s->sclk = sclk;  s->mosi = mosi;  s->miso = miso;
+} // setup_spi_dec
+
+//
+// Pulse trains
+//
+
+static void pulse_edge(struct decoder *d, unsigned long long t,
+                       unsigned prev, unsigned word)
+{ struct pulse_dec *p = (struct pulse_dec *)d;
+  unsigned chg = (prev ^ word) & d->mask;
+  int g;
+
+  while (chg)
+  { g = __builtin_ctz(chg);
+    chg &= chg - 1;
+    if (word & (1<<g))
+    { if (p->pulses[g])
+        printf("%12.3f PULSE GPIO%d period %.3f us\n", t/1e3, g,
+               (t - p->rise[g])/1e3);
+      p->rise[g] = t;
+    }
+    else if (p->rise[g] || p->pulses[g])
+    { printf("%12.3f PULSE GPIO%d high %.3f us\n", p->rise[g]/1e3, g,
+             (t - p->rise[g])/1e3);
+      p->pulses[g]++;
+    }
+  }
+} // pulse_edge
+
+static void pulse_finish(struct decoder *d, unsigned long long t)
+{ struct pulse_dec *p = (struct pulse_dec *)d;
+  int g;
+  for (g = 0; g < 32; g++)
+    if (d->mask & (1<<g))
+      printf("PULSE GPIO%d: %lu pulses\n", g, p->pulses[g]);
+} // pulse_finish
+
+void setup_pulse_dec(struct pulse_dec *p, unsigned mask)
+{
+  memset(p, 0, sizeof(*p));
+  p->dec.mask   = mask;
+  p->dec.edge   = pulse_edge;
+  p->dec.finish = pulse_finish;
+} // setup_pulse_dec
+
+//
+// Run all decoders over a capture file in one pass
+// Returns 0 on success
+//
+int decode_capture(const char *file, struct decoder **dec, int ndec)
+{ struct capture_header hdr;
+  struct capture_rec *buf;
+  unsigned long long t, n;
+  unsigned prev, word, chg, all;
+  size_t got, i;
+  int k;
+  FILE *fp;
+
+  if ((fp = fopen(file, "rb")) == NULL)
+  { printf("Can't open %s\n", file);
+    return -1;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != CAPTURE_MAGIC)
+  { printf("%s is not a capture file\n", file);
+    fclose(fp);
+    return -1;
+  }
+  if ((buf = malloc(BLOCK_RECS * sizeof(*buf))) == NULL)
+  { printf("allocation error \n");
+    fclose(fp);
+    return -1;
+  }
+
+  all = 0;
+  for (k = 0; k < ndec; k++)
+    all |= dec[k]->mask;
+
+  n = 0;  // time in samples
+  prev = hdr.first;
+  while ((got = fread(buf, sizeof(*buf), BLOCK_RECS, fp)) > 0)
+  { for (i = 0; i < got; i++)
+    { n += buf[i].delta;
+      word = buf[i].word;
+      chg = prev ^ word;
+      if (chg & all)
+      { t = n * hdr.period;
+        for (k = 0; k < ndec; k++)
+          if (chg & dec[k]->mask)
+            dec[k]->edge(dec[k], t, prev, word);
+      }
+      prev = word;
+    }
+  }
+
+  t = n * hdr.period;
+  for (k = 0; k < ndec; k++)
+    dec[k]->finish(dec[k], t);
+  free(buf);
+  fclose(fp);
+  return 0;
+} // decode_capture
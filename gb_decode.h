@@ -0,0 +1,71 @@
+//
+// Gertboard test suite
+//
+// capture protocol decoder header file
+// (include gb_capture.h first)
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// A decoder is called for every change on one of the pins in its mask.
+// prev and word are the masked input words before and after the change.
+struct decoder {
+  unsigned mask;
+  void (*edge)(struct decoder *d, unsigned long long t,
+               unsigned prev, unsigned word);
+  void (*finish)(struct decoder *d, unsigned long long t);
+};
+
+// UART, 8 data bits, no parity, 1 stop bit, idle high
+struct uart_dec {
+  struct decoder dec;
+  int pin;
+  unsigned long long bit_ns;   // one bit time
+  unsigned long long next;     // time of the next bit sample (0=idle)
+  int level;                   // current line level
+  int nbit;                    // bits sampled in this frame
+  unsigned shift;
+  unsigned long long start;    // time of the start bit
+  unsigned long frames, errors;
+};
+
+// SPI mode 0 (data sampled on rising clock), chip select active low
+struct spi_dec {
+  struct decoder dec;
+  int cs, sclk, mosi, miso;
+  int active, nbit, nbyte;
+  unsigned char mosi_byte, miso_byte;
+  unsigned char mosi_buf[64], miso_buf[64];
+  unsigned long long start;
+  unsigned long transactions;
+};
+
+// Pulse trains: every high pulse on every pin in the mask
+struct pulse_dec {
+  struct decoder dec;
+  unsigned long long rise[32];  // time of last rising edge per pin
+  unsigned long pulses[32];
+};
+
+void setup_uart_dec(struct uart_dec *u, int pin, int baud);
+void setup_spi_dec(struct spi_dec *s, int cs, int sclk, int mosi, int miso);
+void setup_pulse_dec(struct pulse_dec *p, unsigned mask);
+int  decode_capture(const char *file, struct decoder **dec, int ndec);
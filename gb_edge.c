@@ -0,0 +1,348 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Event driven GPIO input
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// The button programs used to read GPIO_IN0 in a tight loop. That works
+// but keeps one CPU 100% busy just waiting for somebody to press a button.
+//
+// The BCM2835 can detect rising and falling edges on every pin and raise
+// an interrupt. We can not handle that interrupt from user space, and
+// we must NOT program the edge detect registers through /dev/mem behind
+// the back of the kernel: an edge nobody acknowledges keeps the GPIO
+// interrupt asserted and locks up the system. So we ask the kernel GPIO
+// driver to program the edge detect registers for us and sleep in poll()
+// until it tells us an edge has happened.
+//
+// Two kernel interfaces are supported:
+// 1/ The GPIO character device (/dev/gpiochip0). This also gives us the
+//    time the interrupt came in, so we can measure the wake-up latency.
+// 2/ The older sysfs interface (/sys/class/gpio). Only wake-ups are
+//    counted here as there is no kernel time stamp.
+// If neither is available wait_edge() returns at once and the caller
+// just polls GPIO_IN0 as before.
+//
+// setup_io() must have been called before (wait_edge reads GPIO_IN0)
+// and the pull-ups must still be set up by the program itself.
+//
+
+#include "gb_common.h"
+#include "gb_edge.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/gpio.h>
+#endif
+
+#define EDGE_NONE    0  // no kernel interface, caller polls
+#define EDGE_CHARDEV 1
+#define EDGE_SYSFS   2
+
+static int edge_if = EDGE_NONE;
+static unsigned edge_mask;
+static int nfds;
+static struct pollfd pfd[32];
+static int pin_of[32];  // which GPIO each pfd belongs to
+static int edge_ep = -1; // all of pfd in one, see edge_fd()
+
+// wake-up statistics
+static unsigned long wakes, timed_wakes;
+static unsigned long long lat_sum, lat_min, lat_max;
+
+#ifdef GPIO_GET_LINEEVENT_IOCTL
+//
+// Ask the GPIO character device for one event file per pin
+//
+static int setup_chardev(unsigned mask, int edges)
+{ struct gpioevent_request req;
+  int chip, g;
+
+  if ((chip = open("/dev/gpiochip0", O_RDONLY)) < 0)
+    return -1;
+  for (g = 0; g < 32; g++)
+  { if (!(mask & (1<<g)))
+      continue;
+    memset(&req, 0, sizeof(req));
+    req.lineoffset  = g;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags  = (edges & EDGE_RISING  ? GPIOEVENT_REQUEST_RISING_EDGE  : 0)
+                    | (edges & EDGE_FALLING ? GPIOEVENT_REQUEST_FALLING_EDGE : 0);
+    strcpy(req.consumer_label, "gertboard");
+    if (ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req) < 0)
+    { printf("Can't get edge events for GPIO%d (%s)\n", g, strerror(errno));
+      close(chip);
+      return -1;
+    }
+    // non-blocking so we can read all queued events in one go
+    fcntl(req.fd, F_SETFL, O_NONBLOCK);
+    pfd[nfds].fd     = req.fd;
+    pfd[nfds].events = POLLIN;
+    pin_of[nfds++]   = g;
+  }
+  // the line event files stay valid after the chip is closed
+  close(chip);
+  return 0;
+} // setup_chardev
+
+//
+// Convert a kernel event time stamp to get_time_ns() time.
+// Older kernels stamp events with CLOCK_REALTIME, newer
+// with CLOCK_MONOTONIC. Real time is many years bigger.
+//
+static unsigned long long event_time(unsigned long long ts,
+                                     unsigned long long now)
+{ struct timespec rt;
+  unsigned long long real;
+
+  if (ts <= now + 1000000000ULL)
+    return ts;
+  clock_gettime(CLOCK_REALTIME, &rt);
+  real = (unsigned long long)rt.tv_sec*1000000000ULL + rt.tv_nsec;
+  return ts - (real - get_time_ns());
+} // event_time
+#endif
+
+//
+// Write a string into a sysfs file
+//
+static int sysfs_write(const char *file, const char *val)
+{ int fd, ok;
+  if ((fd = open(file, O_WRONLY)) < 0)
+    return -1;
+  ok = write(fd, val, strlen(val)) == (int)strlen(val);
+  close(fd);
+  return ok ? 0 : -1;
+} // sysfs_write
+
+static int setup_sysfs(unsigned mask, int edges)
+{ char file[64], num[8], c;
+  int g, fd;
+
+  for (g = 0; g < 32; g++)
+  { if (!(mask & (1<<g)))
+      continue;
+    sprintf(num, "%d", g);
+    // this fails if the pin is already exported, which is fine
+    sysfs_write("/sys/class/gpio/export", num);
+    sprintf(file, "/sys/class/gpio/gpio%d/edge", g);
+    if (sysfs_write(file, edges==EDGE_BOTH ? "both" :
+                          edges==EDGE_RISING ? "rising" : "falling"))
+      return -1;
+    sprintf(file, "/sys/class/gpio/gpio%d/value", g);
+    if ((fd = open(file, O_RDONLY)) < 0)
+      return -1;
+    // read once, else the first poll returns at once
+    (void) read(fd, &c, 1);
+    pfd[nfds].fd     = fd;
+    pfd[nfds].events = POLLPRI|POLLERR;
+    pin_of[nfds++]   = g;
+  }
+  return 0;
+} // setup_sysfs
+
+//
+// Get ready to sleep until one of the pins in 'mask' changes
+// edges: EDGE_RISING, EDGE_FALLING or EDGE_BOTH
+// Returns 0 if the kernel will wake us up,
+// -1 if the caller has to fall back to polling
+//
+int setup_edge(unsigned mask, int edges)
+{
+  restore_edge();
+  edge_mask = mask;
+  wakes = timed_wakes = 0;
+  lat_sum = lat_max = 0;
+  lat_min = ~0ULL;
+
+  // set edge_if first so restore_edge() can clean up half a setup
+#ifdef GPIO_GET_LINEEVENT_IOCTL
+  edge_if = EDGE_CHARDEV;
+  if (setup_chardev(mask, edges) == 0)
+    return 0;
+  restore_edge();
+  edge_mask = mask;
+#endif
+  edge_if = EDGE_SYSFS;
+  if (setup_sysfs(mask, edges) == 0)
+    return 0;
+  restore_edge();
+  edge_mask = mask;
+  printf("No kernel GPIO edge interface, falling back to polling\n");
+  return -1;
+} // setup_edge
+
+//
+// Sleep until one of the pins changes or the timeout (in ms, -1 is
+// forever) expires.
+// changed : the pins which had an edge (may be NULL)
+// level   : GPIO_IN0 for the pins we watch after waking up (may be NULL)
+// when    : time of the first edge in get_time_ns() time (may be NULL)
+// Returns 1 on an edge, 0 on a timeout.
+// Without a kernel interface this returns 1 at once with all pins
+// marked as changed so the caller can compare the levels itself.
+//
+int wait_edge(int timeout_ms, unsigned *changed, unsigned *level,
+              unsigned long long *when)
+{ unsigned long long now, first, lat;
+  unsigned chg;
+  int i, r, timed;
+  char buf[8];
+#ifdef GPIO_GET_LINEEVENT_IOCTL
+  struct gpioevent_data ev;
+  unsigned long long t;
+#endif
+
+  if (edge_if == EDGE_NONE)
+  { if (changed) *changed = edge_mask;
+    if (level)   *level   = GPIO_IN0 & edge_mask;
+    if (when)    *when    = get_time_ns();
+    return 1;
+  }
+
+  do {
+    r = poll(pfd, nfds, timeout_ms);
+  } while (r < 0 && errno == EINTR);
+  now = get_time_ns();
+  if (r <= 0)
+    return 0;
+
+  chg = 0;
+  first = now;
+  timed = 0;
+  for (i = 0; i < nfds; i++)
+  { if (!pfd[i].revents)
+      continue;
+    chg |= 1<<pin_of[i];
+#ifdef GPIO_GET_LINEEVENT_IOCTL
+    if (edge_if == EDGE_CHARDEV)
+    { while (read(pfd[i].fd, &ev, sizeof(ev)) == sizeof(ev))
+      { t = event_time(ev.timestamp, now);
+        if (t < first) first = t;
+        timed = 1;
+      }
+      continue;
+    }
+#endif
+    lseek(pfd[i].fd, 0, SEEK_SET);
+    (void) read(pfd[i].fd, buf, sizeof(buf));
+  }
+
+  wakes++;
+  if (timed)
+  { lat = now - first;
+    timed_wakes++;
+    lat_sum += lat;
+    if (lat < lat_min) lat_min = lat;
+    if (lat > lat_max) lat_max = lat;
+  }
+
+  if (changed) *changed = chg;
+  if (level)   *level   = GPIO_IN0 & edge_mask;
+  if (when)    *when    = first;
+  return 1;
+} // wait_edge
+
+//
+// Returns 1 if wait_edge() really sleeps, 0 if it returns at once
+//
+int edge_ready()
+{
+  return edge_if != EDGE_NONE;
+} // edge_ready
+
+//
+// One file descriptor which is readable as long as one of the pins
+// had an edge, for programs which wait for other things as well (e.g.
+// AWAIT_FD in gb_task.h). It does not say which pin: call
+// wait_edge(0, ...) then, which also clears it.
+// Returns -1 without a kernel interface.
+//
+int edge_fd()
+{ struct epoll_event ev;
+  int i;
+
+  if (edge_if == EDGE_NONE)
+    return -1;
+  if (edge_ep >= 0)
+    return edge_ep;
+  if ((edge_ep = epoll_create1(0)) < 0)
+    return -1;
+  for (i = 0; i < nfds; i++)
+  { // the poll and epoll bits are the same
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = pfd[i].events;
+    ev.data.fd = pfd[i].fd;
+    if (epoll_ctl(edge_ep, EPOLL_CTL_ADD, pfd[i].fd, &ev) < 0)
+    { close(edge_ep);
+      edge_ep = -1;
+      return -1;
+    }
+  }
+  return edge_ep;
+} // edge_fd
+
+//
+// Show how often we woke up and how long the kernel took to wake us
+//
+void print_edge_stats()
+{
+  if (edge_if == EDGE_NONE)
+    return;
+  printf("%lu edge wake-ups", wakes);
+  if (timed_wakes)
+    printf(", wake-up latency (us): min %.1f avg %.1f max %.1f",
+           lat_min/1000.0, (double)lat_sum/timed_wakes/1000.0, lat_max/1000.0);
+  printf("\n");
+} // print_edge_stats
+
+//
+// Give the pins back to the kernel
+//
+void restore_edge()
+{ char num[8];
+  int i;
+
+  for (i = 0; i < nfds; i++)
+  { close(pfd[i].fd);
+    if (edge_if == EDGE_SYSFS)
+    { sprintf(num, "%d", pin_of[i]);
+      sysfs_write("/sys/class/gpio/unexport", num);
+    }
+  }
+  nfds = 0;
+  if (edge_ep >= 0)
+  { close(edge_ep);
+    edge_ep = -1;
+  }
+  edge_if = EDGE_NONE;
+} // restore_edge
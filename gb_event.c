@@ -0,0 +1,236 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Timestamped input event queue
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Every program which uses the buttons used to do its own change
+// detection. Here one sampler thread debounces the inputs (gb_debounce.c)
+// and turns every change into a {pin, edge, time} event.
+//
+// The events go into one ring buffer. There is only one writer (the
+// sampler thread) and every reader keeps its own read position, so any
+// number of consumers can look at the same events without locks. If a
+// reader is too slow the oldest events are overwritten and counted as
+// lost for that reader.
+//
+// Every reader also gets an eventfd which becomes readable when new
+// events arrive. Put it in your own poll/epoll loop, or just call
+// gb_next_event() which blocks until there is an event.
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_edge.h"
+#include "gb_debounce.h"
+#include "gb_event.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define EVENT_RING   256  // must be a power of 2
+#define MAX_READERS  8
+
+static struct gb_event ring[EVENT_RING];
+static unsigned long head;           // next slot the sampler writes
+static int reader_fd[MAX_READERS];   // -1 = free
+static int nreaders;
+
+static pthread_t sampler;
+static int sampler_running;
+static struct debounce deb;
+static unsigned long sample_period;
+
+static void signal_readers()
+{ unsigned long long one = 1;
+  int i, fd;
+  for (i = 0; i < __atomic_load_n(&nreaders, __ATOMIC_ACQUIRE); i++)
+    if ((fd = __atomic_load_n(&reader_fd[i], __ATOMIC_RELAXED)) >= 0)
+      (void) write(fd, &one, sizeof(one));
+} // signal_readers
+
+//
+// The sampler thread: debounce, turn changes into events
+//
+static void *sample_inputs(void *arg)
+{ unsigned toggle, bit;
+  unsigned long long now;
+  unsigned long h;
+  struct gb_event *ev;
+  int g;
+
+  while (1)
+  { toggle = wait_debounced(&deb, sample_period, NULL, NULL);
+    now = get_time_ns();
+    h = head;
+    for (g = 0; g < 32; g++)
+    { bit = 1<<g;
+      if (!(toggle & bit))
+        continue;
+      // head must be seen moving on before this slot changes,
+      // so a reader still copying it notices (see gb_poll_event)
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      ev = &ring[h & (EVENT_RING-1)];
+      ev->when = now;
+      ev->pin  = g;
+      ev->edge = deb.state & bit ? EDGE_RISING : EDGE_FALLING;
+      // make the event visible, after it has been written
+      __atomic_store_n(&head, ++h, __ATOMIC_RELEASE);
+    }
+    signal_readers();
+  }
+  return NULL;
+} // sample_inputs
+
+//
+// Start the sampler thread
+// mask   : pins to watch
+// invert : pins which are active low
+// period : sample period in ns while the inputs are bouncing
+// If setup_edge() was done for these pins the thread sleeps
+// while all inputs are stable.
+// Returns 0 on success
+//
+int start_events(unsigned mask, unsigned invert, unsigned long period)
+{ int i;
+
+  if (sampler_running)
+    return -1;
+  for (i = 0; i < MAX_READERS; i++)
+    reader_fd[i] = -1;
+  nreaders = 0;
+  head = 0;
+  sample_period = period;
+  setup_debounce(&deb, mask, invert);
+  if (pthread_create(&sampler, NULL, sample_inputs, NULL))
+  { printf("Can't start the input sampler thread\n");
+    return -1;
+  }
+  sampler_running = 1;
+  return 0;
+} // start_events
+
+void stop_events()
+{
+  if (!sampler_running)
+    return;
+  pthread_cancel(sampler);
+  pthread_join(sampler, NULL);
+  sampler_running = 0;
+} // stop_events
+
+//
+// Become a consumer. Only events which come in from now on are seen.
+// Returns the eventfd to wait on, or -1
+//
+int open_events(struct event_reader *r)
+{ int i;
+
+  if ((r->fd = eventfd(0, EFD_NONBLOCK)) < 0)
+    return -1;
+  r->tail = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  r->lost = 0;
+  for (i = 0; i < MAX_READERS; i++)
+  { if (__atomic_load_n(&reader_fd[i], __ATOMIC_RELAXED) < 0)
+    { __atomic_store_n(&reader_fd[i], r->fd, __ATOMIC_RELAXED);
+      if (i >= nreaders)
+        __atomic_store_n(&nreaders, i+1, __ATOMIC_RELEASE);
+      return r->fd;
+    }
+  }
+  close(r->fd);
+  r->fd = -1;
+  return -1;
+} // open_events
+
+void close_events(struct event_reader *r)
+{ int i;
+  for (i = 0; i < MAX_READERS; i++)
+    if (reader_fd[i] == r->fd)
+      __atomic_store_n(&reader_fd[i], -1, __ATOMIC_RELAXED);
+  close(r->fd);
+  r->fd = -1;
+} // close_events
+
+//
+// Get the next event if there is one (does not block)
+// Returns 1 if *ev was filled in, 0 if there are no events
+//
+int gb_poll_event(struct event_reader *r, struct gb_event *ev)
+{ unsigned long h;
+
+  while (1)
+  { h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    // slot 'head' may be being written, so only EVENT_RING-1
+    // events behind head are safe to read
+    if (h - r->tail >= EVENT_RING)
+    { // we were too slow, skip to the oldest event still there
+      r->lost += h - r->tail - (EVENT_RING-1);
+      r->tail  = h - (EVENT_RING-1);
+    }
+    if (r->tail == h)
+      return 0;
+    *ev = ring[r->tail & (EVENT_RING-1)];
+    // the sampler may have overwritten the slot while we copied it.
+    // The fence keeps the copy before the second look at head
+    // (an acquire load alone does not order the loads before it).
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    if (h - r->tail < EVENT_RING)
+    { r->tail++;
+      return 1;
+    }
+  }
+} // gb_poll_event
+
+//
+// Wait for the next event
+// timeout_ms : -1 waits forever
+// Returns 1 if *ev was filled in, 0 on a timeout
+//
+int gb_next_event(struct event_reader *r, struct gb_event *ev, int timeout_ms)
+{ struct pollfd pfd;
+  unsigned long long cnt;
+  int n;
+
+  pfd.fd = r->fd;
+  pfd.events = POLLIN;
+  while (1)
+  { // clear the eventfd first, then look: an event that comes in
+    // after we looked will make the eventfd readable again
+    (void) read(r->fd, &cnt, sizeof(cnt));
+    if (gb_poll_event(r, ev))
+      return 1;
+    n = poll(&pfd, 1, timeout_ms);
+    if (n == 0)
+      return 0;
+    if (n < 0 && errno != EINTR)
+      return 0;
+  }
+} // gb_next_event
@@ -0,0 +1,47 @@
+//
+// Gertboard test suite
+//
+// input event queue header file
+// (include gb_edge.h first for EDGE_RISING/EDGE_FALLING)
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// One debounced change on one pin
+struct gb_event {
+  unsigned long long when;  // get_time_ns() time of the change
+  unsigned char pin;        // GPIO number
+  unsigned char edge;       // EDGE_RISING: became active, EDGE_FALLING: inactive
+};
+
+// Every consumer has its own read position in the shared ring
+struct event_reader {
+  unsigned long tail;  // next event to read
+  unsigned long lost;  // events overwritten before we read them
+  int fd;              // eventfd, readable when events are waiting
+};
+
+int  start_events(unsigned mask, unsigned invert, unsigned long period);
+void stop_events();
+int  open_events(struct event_reader *r);
+void close_events(struct event_reader *r);
+int  gb_poll_event(struct event_reader *r, struct gb_event *ev);
+int  gb_next_event(struct event_reader *r, struct gb_event *ev, int timeout_ms);
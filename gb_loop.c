@@ -0,0 +1,194 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Fixed-rate control loop
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A control loop reads an input, works out what to do and writes an
+// output, over and over. How well it controls depends on doing that at
+// a steady rate and on the time between reading and writing. A loop
+// like while(1) { read; compute; write; short_wait(); } has neither:
+// its rate depends on the CPU and nobody knows it.
+//
+// run_loop() calls a step function at a fixed period on absolute
+// deadlines (see wait_until_ns). The step function calls loop_input()
+// right after reading its input and loop_output() right after writing
+// its output. We keep statistics on:
+//   - how late every cycle started (wake-up jitter)
+//   - the input to output latency
+//   - overruns: the step did not finish before the next deadline. The
+//     cycles we are too late for are skipped, not run in a burst, so
+//     the loop stays on its time grid.
+//
+// There is also a simple filter (moving average) and a direction
+// decision with hysteresis, so a noisy input sitting on the midpoint
+// does not make the output switch back and forth.
+//
+
+#include "gb_common.h"
+#include "gb_loop.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void setup_loop(struct ctl_loop *l, unsigned long period,
+                unsigned long spin, unsigned long res)
+{
+  memset(l, 0, sizeof(*l));
+  l->period = period ? period : 1;
+  l->spin   = spin;
+  l->res    = res ? res : 1000;
+  l->late_min = l->lat_min = 0x7FFFFFFF;
+} // setup_loop
+
+//
+// Call right after reading the input
+//
+void loop_input(struct ctl_loop *l)
+{
+  l->t_in = get_time_ns();
+} // loop_input
+
+//
+// Call right after writing the output
+//
+void loop_output(struct ctl_loop *l)
+{
+  l->t_out = get_time_ns();
+} // loop_output
+
+//
+// Run step every period until it returns non-zero
+// or for 'cycles' cycles (0 = no limit)
+//
+void run_loop(struct ctl_loop *l, loop_step step, void *arg,
+              unsigned long long cycles)
+{ unsigned long long now, t0, behind;
+  long late, lat;
+  int done;
+
+  l->start = get_time_ns() + l->period;
+  t0 = l->start;
+  done = 0;
+  while (!done && (!cycles || l->cycles < cycles))
+  { wait_until_ns(l->start, l->spin);
+    now = get_time_ns();
+    late = (long)(now - l->start);
+    l->t_in = l->t_out = 0;
+
+    done = step(l, arg);
+    l->cycles++;
+
+    l->late_sum += late;
+    if (late < l->late_min) l->late_min = late;
+    if (late > l->late_max) l->late_max = late;
+    hist_add(l->late_hist, late, l->res);
+    if (l->t_in && l->t_out >= l->t_in)
+    { lat = (long)(l->t_out - l->t_in);
+      l->lat_n++;
+      l->lat_sum += lat;
+      if (lat < l->lat_min) l->lat_min = lat;
+      if (lat > l->lat_max) l->lat_max = lat;
+      hist_add(l->lat_hist, lat, l->res);
+    }
+
+    l->start += l->period;
+    now = get_time_ns();
+    if (now > l->start)
+    { // did not make it: skip to the next deadline still ahead
+      l->overruns++;
+      behind = (now - l->start) / l->period + 1;
+      l->skipped += behind;
+      l->start += behind * l->period;
+    }
+  }
+  l->ns = get_time_ns() - t0;
+} // run_loop
+
+//
+// Print rate, overruns and (if hist) the histograms
+//
+void print_loop_stats(struct ctl_loop *l, int hist)
+{
+  if (!l->cycles)
+    return;
+  printf("%llu cycles in %.3f s: %.1f Hz (asked for %.1f Hz)\n",
+         l->cycles, l->ns/1e9, l->cycles/(l->ns/1e9), 1e9/l->period);
+  if (l->overruns)
+    printf("%llu overruns, %llu cycles skipped\n", l->overruns, l->skipped);
+  if (hist)
+    hist_print("wake-up lateness", l->late_hist, l->res,
+               l->late_min, l->late_max, l->late_sum, l->cycles);
+  else
+    printf("wake-up lateness (ns): min %ld avg %.0f max %ld\n",
+           l->late_min, l->late_sum/l->cycles, l->late_max);
+  if (!l->lat_n)
+  { // say so, a missing line is easy to overlook
+    printf("input to output latency: not measured "
+           "(step did not call loop_input and loop_output)\n");
+    return;
+  }
+  if (hist)
+    hist_print("input to output latency", l->lat_hist, l->res,
+               l->lat_min, l->lat_max, l->lat_sum, l->lat_n);
+  else
+    printf("input to output latency (ns): min %ld avg %.0f max %ld\n",
+           l->lat_min, l->lat_sum/l->lat_n, l->lat_max);
+} // print_loop_stats
+
+//
+// Exponential moving average filter
+// shift 0 is no filtering, every step up halves the bandwidth
+//
+void setup_ema(struct ema *f, int shift)
+{
+  f->y = 0;
+  f->shift = shift;
+  f->primed = 0;
+} // setup_ema
+
+int ema(struct ema *f, int x)
+{
+  if (!f->primed)
+  { // start at the first value, not at 0
+    f->y = x << f->shift;
+    f->primed = 1;
+  }
+  else
+    f->y += x - (f->y >> f->shift);
+  return f->y >> f->shift;
+} // ema
+
+//
+// Decide on a direction (1 = above mid, 0 = below)
+// The direction only changes once v is more than band away from mid
+// on the other side.
+//
+int hysteresis(int dir, int v, int mid, int band)
+{
+  if (dir && v < mid - band)
+    return 0;
+  if (!dir && v > mid + band)
+    return 1;
+  return dir;
+} // hysteresis
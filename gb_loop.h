@@ -0,0 +1,68 @@
+//
+// Gertboard test suite
+//
+// fixed-rate control loop header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+struct ctl_loop {
+  unsigned long period;          // ns
+  unsigned long spin;            // ns busy-wait before each cycle
+  unsigned long res;             // ns per histogram bucket
+  unsigned long long start;      // deadline of this cycle
+  unsigned long long t_in;       // when the input was read
+  unsigned long long t_out;      // when the output was written
+  // statistics
+  unsigned long long cycles;     // cycles run
+  unsigned long long overruns;   // cycles which did not finish in time
+  unsigned long long skipped;    // cycles dropped because of overruns
+  unsigned long long ns;         // duration of the run
+  unsigned long long lat_n;      // cycles with an input and output stamp
+  long late_min, late_max;       // wake-up lateness
+  long lat_min, lat_max;         // input to output latency
+  double late_sum, lat_sum;
+  unsigned late_hist[HIST_BUCKETS], lat_hist[HIST_BUCKETS];
+};
+
+// step is called once per period and returns 0 to keep going
+typedef int (*loop_step)(struct ctl_loop *l, void *arg);
+
+void setup_loop(struct ctl_loop *l, unsigned long period,
+                unsigned long spin, unsigned long res);
+void loop_input(struct ctl_loop *l);
+void loop_output(struct ctl_loop *l);
+void run_loop(struct ctl_loop *l, loop_step step, void *arg,
+              unsigned long long cycles);
+void print_loop_stats(struct ctl_loop *l, int hist);
+
+// Filter: exponential moving average, y += (x-y) / 2^shift
+struct ema {
+  int y;      // filtered value << shift
+  int shift;
+  int primed;
+};
+
+void setup_ema(struct ema *f, int shift);
+int  ema(struct ema *f, int x);
+
+// Direction with hysteresis around a midpoint
+int  hysteresis(int dir, int v, int mid, int band);
@@ -0,0 +1,304 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Motion profiles: timed speed ramps for the motor
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Instead of stepping the PWM value in a loop with long_wait() (which
+// runs faster or slower with every CPU and compiler setting) we work
+// out the speed for every tick of a fixed-rate clock beforehand:
+//
+//  trapezoid (jerk = 0): the speed changes 'accel' PWM steps per second
+//  until it reaches the target
+//
+//  S-curve (jerk > 0): the acceleration itself ramps up at 'jerk' steps
+//  per second^2 to at most 'accel', and ramps down again before the
+//  target, so there are no sudden changes in torque:
+//
+//  speed         ______             accel      __
+//               /                             /  \_
+//             _/                            _/     \_
+//
+// A motion thread plays the profiles on absolute deadlines (see
+// wait_until_ns), one after the other without a gap, while the main
+// program does something else. A profile may go through zero: the
+// thread then switches direction exactly there. As in motor.c:
+//   forward : B (GPIO17) low,  normal PWM polarity
+//   backward: B (GPIO17) high, PWM0_REVPOLAR
+// a PWM value of 0 is 'no power' in both, so we switch at 0.
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_pwm.h"
+#include "gb_motion.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+static pthread_t mover;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond = PTHREAD_COND_INITIALIZER;
+static struct profile *queue_head, *queue_tail;
+static struct profile *moving;
+static int mover_running;
+static unsigned long motion_tick, motion_spin;
+static int b_mask;
+static int backward;           // current direction
+static volatile int speed_now; // last speed sent to the motor
+
+//
+// Speed t seconds into a change of 'dv' (>0) starting at 0
+// T is the total time of the change
+//
+static double ramp(double t, double T, double dv, double accel, double jerk)
+{ double t1, t2, a;
+
+  if (jerk <= 0)
+    return accel * t;
+  // accelerate: jerk phase t1, constant phase t2, jerk phase t1
+  t1 = accel / jerk;
+  if (dv >= accel * t1)
+    t2 = dv / accel - t1;
+  else
+  { // never reaches full acceleration
+    t1 = sqrt(dv / jerk);
+    t2 = 0;
+  }
+  a = jerk * t1;
+  if (t < t1)
+    return jerk * t * t / 2;
+  if (t < t1 + t2)
+    return jerk * t1 * t1 / 2 + a * (t - t1);
+  t = T - t;
+  return dv - jerk * t * t / 2;
+} // ramp
+
+//
+// Work out the speed for every tick to go from speed 'from' to 'to'
+// and then stay at 'to' for 'hold' seconds
+// accel in PWM steps per second, jerk in steps per second^2 (0 for a
+// trapezoid ramp)
+// Returns 0 on success
+//
+int plan_profile(struct profile *p, int from, int to, double accel,
+                 double jerk, double hold, unsigned long tick_ns)
+{ double dv, T, t1, dt, v;
+  int i, n, ramp_n, dir;
+
+  memset(p, 0, sizeof(*p));
+  if (accel <= 0 || tick_ns == 0)
+    return -1;
+  dir = to >= from ? 1 : -1;
+  dv  = (to - from) * dir;
+  if (jerk <= 0)
+    T = dv / accel;
+  else
+  { t1 = accel / jerk;
+    if (dv >= accel * t1)
+      T = dv / accel + t1;
+    else
+      T = 2 * sqrt(dv / jerk);
+  }
+  dt = tick_ns / 1e9;
+  ramp_n = (int)ceil(T / dt);
+  n = ramp_n + (int)(hold / dt + 0.5);
+  if (n < 1)
+    n = 1;
+  if ((p->speed = malloc(n * sizeof(int))) == NULL)
+  { printf("allocation error \n");
+    return -1;
+  }
+  // the first tick is one tick into the ramp, the last is 'to'
+  for (i = 0; i < n; i++)
+  { if (i+1 >= ramp_n)
+      p->speed[i] = to;
+    else
+    { v = ramp((i+1) * dt, T, dv, accel, jerk);
+      p->speed[i] = from + dir * (int)(v + 0.5);
+    }
+  }
+  p->n = n;
+  return 0;
+} // plan_profile
+
+void free_profile(struct profile *p)
+{
+  free(p->speed);
+  p->speed = NULL;
+  p->n = 0;
+} // free_profile
+
+//
+// Send a signed speed to the motor, switching direction if needed
+//
+static void set_speed(int v)
+{ int back;
+
+  back = v < 0;
+  if (v != 0 && back != backward)
+  { // zero crossing: no power, swap B and the polarity, go on
+    update_pwm0(0, backward ? PWM0_ENABLE|PWM0_REVPOLAR : PWM0_ENABLE);
+    if (back)
+      GPIO_SET0 = b_mask;
+    else
+      GPIO_CLR0 = b_mask;
+    backward = back;
+    update_pwm0(back ? -v : v,
+                back ? PWM0_ENABLE|PWM0_REVPOLAR : PWM0_ENABLE);
+  }
+  else
+    set_pwm0(back ? -v : v);
+  speed_now = v;
+} // set_speed
+
+static void unlock_queue(void *arg)
+{
+  pthread_mutex_unlock(&lock);
+} // unlock_queue
+
+static void *motion_thread(void *arg)
+{ unsigned long long base;
+  struct profile *p;
+  int i;
+
+  base = 0;
+  while (1)
+  { pthread_mutex_lock(&lock);
+    // cond_wait is where stop_motion() cancels us: give back the lock
+    pthread_cleanup_push(unlock_queue, NULL);
+    moving = NULL;
+    pthread_cond_broadcast(&cond);  // for wait_motion()
+    while (!queue_head)
+    { pthread_cond_wait(&cond, &lock);
+      base = 0;  // we have been idle: start from now
+    }
+    p = queue_head;
+    queue_head = p->next;
+    if (!queue_head)
+      queue_tail = NULL;
+    moving = p;
+    pthread_cleanup_pop(1);
+
+    if (!base)
+      base = get_time_ns();
+    for (i = 0; i < p->n; i++)
+    { base += motion_tick;
+      wait_until_ns(base, motion_spin);
+      set_speed(p->speed[i]);
+    }
+    // the last speed of a profile must arrive, also when the PWM
+    // had not taken the one before it yet (see set_pwm). Give up
+    // after a few ticks, the PWM clock may have been stopped.
+    for (i = 0; i < 4 && !flush_pwm(0); i++)
+    { base += motion_tick;
+      wait_until_ns(base, motion_spin);
+    }
+  }
+  return NULL;
+} // motion_thread
+
+//
+// Start the motion thread
+// b_pin   : GPIO driving motor input B (GPIO17 on the Gertboard)
+// tick_ns : time between speed updates, use at least one PWM period
+// spin    : ns to busy-wait before each tick (0 = sleep only)
+// setup_pwm() must have been done, the motor starts stopped, forward.
+// Call setup_rt() first to give the thread real-time priority.
+// Returns 0 on success
+//
+int start_motion(int b_pin, unsigned long tick_ns, unsigned long spin)
+{
+  b_mask = 1 << b_pin;
+  motion_tick = tick_ns;
+  motion_spin = spin;
+  queue_head = queue_tail = moving = NULL;
+  GPIO_CLR0 = b_mask;
+  backward = 0;
+  speed_now = 0;
+  update_pwm0(0, PWM0_ENABLE);
+  if (pthread_create(&mover, NULL, motion_thread, NULL))
+  { printf("Can't start the motion thread\n");
+    return -1;
+  }
+  mover_running = 1;
+  return 0;
+} // start_motion
+
+//
+// Play 'p' after everything queued before it.
+// The queue plays the speeds as they are: give plan_profile() the
+// speed the profile before it ends at, or the motor gets a jump.
+// p must stay valid until it has been played.
+//
+void queue_profile(struct profile *p)
+{
+  pthread_mutex_lock(&lock);
+  p->next = NULL;
+  if (queue_tail)
+    queue_tail->next = p;
+  else
+    queue_head = p;
+  queue_tail = p;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+} // queue_profile
+
+//
+// Wait until everything queued has been played
+//
+void wait_motion()
+{
+  pthread_mutex_lock(&lock);
+  while (queue_head || moving)
+    pthread_cond_wait(&cond, &lock);
+  pthread_mutex_unlock(&lock);
+} // wait_motion
+
+//
+// The speed the motor has been set to last
+//
+int motion_speed()
+{
+  return speed_now;
+} // motion_speed
+
+//
+// Stop the thread where it is and switch the motor off
+//
+void stop_motion()
+{
+  if (!mover_running)
+    return;
+  pthread_cancel(mover);
+  pthread_join(mover, NULL);
+  mover_running = 0;
+  GPIO_CLR0 = b_mask;
+  backward = 0;
+  speed_now = 0;
+  pwm_off();
+} // stop_motion
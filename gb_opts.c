@@ -0,0 +1,227 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Common command line options, run loop and summary
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// The test programs were written to be run by hand: print the wiring,
+// wait for enter, run a fixed number of times. To use them for soak
+// tests or to measure how fast things go they need to run unattended,
+// for as long or as often as we say, and tell us what they achieved in
+// a form a script can read.
+//
+// A program calls setup_opts() first, skips its wiring help when
+// o.batch is set, and runs its main loop as
+//   while (next_iteration(&o))
+//   { ...one read, write, change...
+//   }
+// next_iteration() counts, keeps to the rate (absolute deadlines, see
+// wait_until_ns) and measures how long every iteration took. At the end
+// print_summary() prints one line of key=value pairs, e.g.
+//   summary prog=atod chan=0 iterations=100000 seconds=1.53 rate=65359.5
+//     lat_min_us=13.2 lat_avg_us=15.1 lat_max_us=81.0 late=0
+// (all on one line), to stdout or appended to the -o file.
+//
+
+#include "gb_common.h"
+#include "gb_opts.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void opts_usage(struct gb_opts *o, int min_chan, int max_chan)
+{
+  fprintf(stderr, "Usage: %s [-b]", o->prog);
+  if (min_chan <= max_chan)
+    fprintf(stderr, " [-c %d..%d]", min_chan, max_chan);
+  fprintf(stderr, " [-n count] [-t seconds] [-r rate] [-o file]\n"
+    "  -b batch: no wiring help, do not wait for enter\n"
+    "  -n 0 runs until -t is over\n");
+  exit(EXIT_FAILURE);
+} // opts_usage
+
+//
+// Parse the options. 'count' is the number of iterations when neither
+// -n nor -t is given. Channels min_chan..max_chan are accepted with -c,
+// if min_chan > max_chan the program has no channels.
+//
+void setup_opts(struct gb_opts *o, int argc, char **argv,
+                long count, int min_chan, int max_chan)
+{ int c, n_given;
+
+  memset(o, 0, sizeof(*o));
+  o->prog = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+  o->chan = -1;
+  o->count = count;
+  n_given = 0;
+  while ((c = getopt(argc, argv, "bc:n:t:r:o:")) != -1)
+  {
+    switch (c)
+    {
+    case 'b' : o->batch   = 1; break;
+    case 'c' : o->chan    = atoi(optarg); break;
+    case 'n' : o->count   = atol(optarg); n_given = 1; break;
+    case 't' : o->seconds = atof(optarg); break;
+    case 'r' : o->rate    = atof(optarg); break;
+    case 'o' : o->out     = optarg; break;
+    default: opts_usage(o, min_chan, max_chan);
+    }
+  }
+  if (optind < argc || o->count < 0 || o->seconds < 0 || o->rate < 0 ||
+      (o->chan != -1 && (o->chan < min_chan || o->chan > max_chan)))
+    opts_usage(o, min_chan, max_chan);
+  // only a time given: run for that time
+  if (o->seconds > 0 && !n_given)
+    o->count = 0;
+  o->lat_min = o->val_min = 0x7FFFFFFF;
+  o->lat_max = o->val_max = -0x7FFFFFFF;
+  o->lat_key = "lat";
+} // setup_opts
+
+//
+// The channel from -c, or else ask for it ('question' is printed),
+// in batch mode without -c the lowest channel is used
+//
+int opts_channel(struct gb_opts *o, const char *question, int min, int max)
+{ int c;
+
+  if (o->chan < 0 && o->batch)
+    o->chan = min;
+  while (o->chan < 0)
+  { printf("%s\n", question);
+    c = getchar();
+    if (c == EOF)
+      exit(EXIT_FAILURE);
+    if (c != '\n')
+      (void) getchar(); // eat carriage return
+    if (c >= '0' + min && c <= '0' + max)
+      o->chan = c - '0';
+  }
+  return o->chan;
+} // opts_channel
+
+//
+// Call at the start of every iteration.
+// Returns 1 to run one more, 0 when the count or the time is up.
+//
+int next_iteration(struct gb_opts *o)
+{ unsigned long long now, deadline, period;
+  long lat;
+
+  now = get_time_ns();
+  if (o->start == 0)
+    o->start = now;
+  else
+  { // the previous iteration is done
+    o->done++;
+    lat = (long)(now - o->last);
+    if (lat < o->lat_min) o->lat_min = lat;
+    if (lat > o->lat_max) o->lat_max = lat;
+    o->lat_sum += lat;
+    o->lat_n++;
+  }
+  o->ns = now - o->start;
+  if ((o->count && o->done >= o->count) ||
+      (o->seconds > 0 && o->ns >= o->seconds * 1e9))
+    return 0;
+
+  if (o->rate > 0)
+  { // iteration n starts at start + n periods, whatever happened before
+    period = (unsigned long long)(1e9 / o->rate);
+    deadline = o->start + (unsigned long long)(o->done * 1e9 / o->rate);
+    if (now >= deadline + period)
+      o->late++;
+    else
+      wait_until_ns(deadline, 0);
+  }
+  o->last = get_time_ns();
+  return 1;
+} // next_iteration
+
+//
+// For programs which wait for something: when -t is over
+// (get_time_ns time, 0 if there is no time limit)
+//
+unsigned long long opts_deadline(struct gb_opts *o)
+{
+  if (o->seconds <= 0)
+    return 0;
+  return o->start + (unsigned long long)(o->seconds * 1e9);
+} // opts_deadline
+
+//
+// The same as a timeout for poll(): ms from now, -1 if no time limit
+//
+int opts_timeout_ms(struct gb_opts *o)
+{ unsigned long long end, now;
+
+  if ((end = opts_deadline(o)) == 0)
+    return -1;
+  now = get_time_ns();
+  return end > now ? (int)((end - now) / 1000000) + 1 : 0;
+} // opts_timeout_ms
+
+//
+// Keep min/avg/max of something the program measured (an ADC value,
+// an error...), they are added to the summary
+//
+void opts_value(struct gb_opts *o, long v)
+{
+  if (v < o->val_min) o->val_min = v;
+  if (v > o->val_max) o->val_max = v;
+  o->val_sum += v;
+  o->val_n++;
+} // opts_value
+
+//
+// One line with everything a script wants to know
+//
+void print_summary(struct gb_opts *o)
+{ FILE *fp;
+
+  fp = stdout;
+  if (o->out && (fp = fopen(o->out, "a")) == NULL)
+  { printf("Can't open %s\n", o->out);
+    fp = stdout;
+  }
+  fprintf(fp, "summary prog=%s", o->prog);
+  if (o->chan >= 0)
+    fprintf(fp, " chan=%d", o->chan);
+  fprintf(fp, " iterations=%ld seconds=%.6f rate=%.1f", o->done, o->ns / 1e9,
+          o->ns ? o->done * 1e9 / o->ns : 0);
+  // lat_ is the time of a whole iteration. A program which put
+  // something else there gives it another key.
+  if (o->lat_n)
+    fprintf(fp, " %s_min_us=%.1f %s_avg_us=%.1f %s_max_us=%.1f",
+            o->lat_key, o->lat_min / 1e3, o->lat_key,
+            o->lat_sum / o->lat_n / 1e3, o->lat_key, o->lat_max / 1e3);
+  fprintf(fp, " late=%ld", o->late);
+  if (o->val_n)
+    fprintf(fp, " val_min=%ld val_avg=%.2f val_max=%ld",
+            o->val_min, o->val_sum / o->val_n, o->val_max);
+  fprintf(fp, "\n");
+  if (fp != stdout)
+    fclose(fp);
+} // print_summary
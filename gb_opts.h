@@ -0,0 +1,62 @@
+//
+// Gertboard test suite
+//
+// common command line options header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// Options every test program understands:
+//   -b          batch: no wiring help, do not wait for enter
+//   -c chan     channel (only programs which have one)
+//   -n count    iterations, 0: no limit
+//   -t seconds  stop after this time
+//   -r rate     iterations per second, 0: as fast as possible
+//   -o file     append the summary line to this file
+struct gb_opts {
+  const char *prog;
+  int batch;
+  int chan;                   // -1 if not given
+  long count;                 // 0: no limit
+  double seconds;             // 0: no limit
+  double rate;                // 0: no pacing
+  const char *out;
+  // what happened, see next_iteration()
+  unsigned long long start, last, ns;
+  long done;                  // iterations finished
+  long late;                  // iterations started a period or more late
+  long lat_min, lat_max;      // ns, time taken by one iteration
+  double lat_sum;
+  long lat_n;
+  const char *lat_key;        // "lat", or the name of what else lat_ holds
+  long val_min, val_max;      // optional measured value, see opts_value()
+  double val_sum;
+  long val_n;
+};
+
+void setup_opts(struct gb_opts *o, int argc, char **argv,
+                long count, int min_chan, int max_chan);
+int  opts_channel(struct gb_opts *o, const char *question, int min, int max);
+int  next_iteration(struct gb_opts *o);
+unsigned long long opts_deadline(struct gb_opts *o);
+int  opts_timeout_ms(struct gb_opts *o);
+void opts_value(struct gb_opts *o, long v);
+void print_summary(struct gb_opts *o);
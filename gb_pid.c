@@ -0,0 +1,111 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Fixed-point PID controller
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A PID controller works out an output (e.g. a PWM value) from the
+// error between where we want to be (setpoint) and where we are
+// (input, e.g. an A/D value):
+//
+//   output = Kp * error  +  Ki * sum of errors  -  Kd * change of input
+//
+// Everything is done in integers: the A/D and PWM values are 10-bit
+// integers anyway and the ARM11 of the first Pi has no fast floating
+// point. Gains have PID_Q (16) fraction bits, so PID_GAIN(1.5) is
+// 1.5 * 65536. Products are done in 64 bits (one multiply instruction
+// on ARM) so large gains and errors do not overflow.
+//
+// Details that make it behave:
+//  - The integral is kept in output units and clamped to the output
+//    range, and it does not grow while the output is already at its
+//    limit in the same direction (anti-windup). Without this the motor
+//    overshoots badly after it has been blocked.
+//  - The derivative works on the input, not on the error, so a step of
+//    the setpoint does not give a kick. It is filtered: every step the
+//    filtered value moves 1/2^d_shift of the way to the new change.
+//  - The output is rounded and clamped to [out_min, out_max].
+//
+// Every controller has its own struct pid, so a program can run as
+// many as it likes (e.g. one per motor).
+//
+
+#include "gb_pid.h"
+
+void setup_pid(struct pid *p, int kp, int ki, int kd, int d_shift,
+               int out_min, int out_max)
+{
+  p->kp = kp;
+  p->ki = ki;
+  p->kd = kd;
+  p->d_shift = d_shift < 0 ? 0 : d_shift > 15 ? 15 : d_shift;
+  p->out_min = out_min;
+  p->out_max = out_max;
+  reset_pid(p);
+} // setup_pid
+
+//
+// Forget the history (integral and derivative)
+//
+void reset_pid(struct pid *p)
+{
+  p->integ  = 0;
+  p->d_filt = 0;
+  p->prev   = 0;
+  p->primed = 0;
+} // reset_pid
+
+//
+// One step of the controller, returns the new output
+//
+int pid_step(struct pid *p, int setpoint, int input)
+{ long long u, i, min, max;
+  int e;
+
+  e = setpoint - input;
+  min = (long long)p->out_min << PID_Q;
+  max = (long long)p->out_max << PID_Q;
+
+  // derivative of the input, filtered
+  if (p->primed)
+    p->d_filt += ((input - p->prev) * PID_ONE - p->d_filt) >> p->d_shift;
+  p->prev   = input;
+  p->primed = 1;
+
+  // integral, clamped to the output range
+  i = p->integ + (long long)p->ki * e;
+  if (i > max) i = max;
+  if (i < min) i = min;
+
+  u = (long long)p->kp * e + i - (((long long)p->kd * p->d_filt) >> PID_Q);
+  if (u > max)
+  { u = max;
+    if (e > 0) i = p->integ;  // do not wind up any further
+  }
+  else if (u < min)
+  { u = min;
+    if (e < 0) i = p->integ;
+  }
+  p->integ = (int)i;
+  return (int)((u + (PID_ONE/2)) >> PID_Q);
+} // pid_step
@@ -0,0 +1,46 @@
+//
+// Gertboard test suite
+//
+// fixed-point PID controller header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// Gains are fixed point numbers with PID_Q fraction bits
+#define PID_Q   16
+#define PID_ONE (1<<PID_Q)
+// Gain from a constant, e.g. PID_GAIN(0.25) (done by the compiler)
+#define PID_GAIN(x) ((int)((x) * PID_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+
+struct pid {
+  int kp, ki, kd;        // gains, PID_Q fraction bits
+  int d_shift;           // derivative filter, see gb_pid.c
+  int out_min, out_max;  // output range, e.g. 0 and 1024 for the PWM
+  int integ;             // integral term, output units << PID_Q
+  int d_filt;            // filtered change of the input << PID_Q
+  int prev;              // previous input
+  int primed;
+};
+
+void setup_pid(struct pid *p, int kp, int ki, int kd, int d_shift,
+               int out_min, int out_max);
+void reset_pid(struct pid *p);
+int  pid_step(struct pid *p, int setpoint, int input);
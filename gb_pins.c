@@ -0,0 +1,99 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Pin groups: logical ports on scattered GPIOs
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// The Gertboard LEDs and buttons are on GPIOs all over the place
+// (0, 1, 4, 7-11, 17, 18, 21-25). Writing a number to 'the LEDs' then
+// means moving every bit to its own GPIO, one at a time.
+//
+// Instead we build tables once. The value is cut in 4 bytes. For byte k
+// and every possible byte value, scatter[k][byte] holds the GPIO bits to
+// set. Writing an N-bit value is then at most 4 table lookups ORed
+// together, plus one clear and one set write. Reading works the other
+// way round: cut GPIO_IN0 in 4 bytes and look up which value bits they
+// give in gather[k][byte].
+//
+
+#include "gb_common.h"
+#include "gb_pins.h"
+
+#include <string.h>
+
+//
+// Build the tables for a group
+// pins : GPIO for value bit 0, 1, 2, ... (max. 32 pins)
+//
+void setup_pin_group(struct pin_group *g, const int *pins, int n)
+{ int k, v, i, bit;
+
+  memset(g, 0, sizeof(*g));
+  if (n > 32) n = 32;
+  g->n = n;
+  for (i = 0; i < n; i++)
+    g->all |= 1 << pins[i];
+
+  for (k = 0; k < 4; k++)
+    for (v = 0; v < 256; v++)
+      for (i = 0; i < 8; i++)
+      { if (!(v & (1<<i)))
+          continue;
+        // scatter: bit i of value byte k is value bit k*8+i
+        if (k*8+i < n)
+          g->scatter[k][v] |= 1 << pins[k*8+i];
+        // gather: bit i of GPIO byte k is GPIO k*8+i
+        for (bit = 0; bit < n; bit++)
+          if (pins[bit] == k*8+i)
+            g->gather[k][v] |= 1 << bit;
+      }
+} // setup_pin_group
+
+//
+// The GPIO bits to set for value v (without touching the pins)
+//
+unsigned pin_group_bits(const struct pin_group *g, unsigned v)
+{
+  return g->scatter[0][v & 0xFF]       | g->scatter[1][(v >> 8) & 0xFF] |
+         g->scatter[2][(v >> 16) & 0xFF] | g->scatter[3][v >> 24];
+} // pin_group_bits
+
+//
+// Put value v on the group (the pins must be outputs)
+//
+void write_pin_group(const struct pin_group *g, unsigned v)
+{ unsigned set;
+  set = pin_group_bits(g, v);
+  GPIO_CLR0 = g->all & ~set;
+  GPIO_SET0 = set;
+} // write_pin_group
+
+//
+// Read the group as a value
+//
+unsigned read_pin_group(const struct pin_group *g)
+{ unsigned in;
+  in = GPIO_IN0;
+  return g->gather[0][in & 0xFF]         | g->gather[1][(in >> 8) & 0xFF] |
+         g->gather[2][(in >> 16) & 0xFF] | g->gather[3][in >> 24];
+} // read_pin_group
@@ -0,0 +1,47 @@
+//
+// Gertboard test suite
+//
+// pin group header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// A pin group is a logical port made of GPIOs which need not be next to
+// each other: bit 0 of a value goes to pins[0], bit 1 to pins[1], etc.
+struct pin_group {
+  int n;                      // number of pins (max. 32)
+  unsigned all;               // GPIO mask of all pins in the group
+  unsigned scatter[4][256];   // value byte -> GPIO bits
+  unsigned gather[4][256];    // GPIO_IN0 byte -> value bits
+};
+
+void     setup_pin_group(struct pin_group *g, const int *pins, int n);
+unsigned pin_group_bits(const struct pin_group *g, unsigned v);
+void     write_pin_group(const struct pin_group *g, unsigned v);
+unsigned read_pin_group(const struct pin_group *g);
+
+// Compile time version for fixed maps: gives the GPIO bits for the
+// 8-bit value v with bit i going to GPIO pi (use -1 for no pin).
+// With a constant v the compiler turns this into a single constant.
+#define PIN_BIT(v,i,p) ((p) < 0 ? 0u : ((((unsigned)(v)) >> (i)) & 1u) << ((p) & 31))
+#define PIN_MAP8(v,p0,p1,p2,p3,p4,p5,p6,p7) \
+  (PIN_BIT(v,0,p0) | PIN_BIT(v,1,p1) | PIN_BIT(v,2,p2) | PIN_BIT(v,3,p3) | \
+   PIN_BIT(v,4,p4) | PIN_BIT(v,5,p5) | PIN_BIT(v,6,p6) | PIN_BIT(v,7,p7))
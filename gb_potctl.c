@@ -0,0 +1,98 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Potentiometer to motor control logic
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// This is the part of potmot which decides what the motor should do
+// for an A/D value. It does not touch any hardware, so the same code
+// runs in potmot on the Gertboard and in the potsim simulator.
+//
+// The A/D value (0..1023) is filtered, then the direction is picked
+// with hysteresis around the middle and the distance from the middle
+// becomes the PWM value (0..1023). Optionally the PWM value may only
+// change 'slew' steps per call, which softens the jumps.
+//
+
+#include "gb_common.h"
+#include "gb_loop.h"
+#include "gb_potctl.h"
+
+void setup_potctl(struct potctl *c, int filter_shift, int band, int slew)
+{
+  setup_ema(&c->filter, filter_shift);
+  c->band = band;
+  c->slew = slew;
+  c->fwd  = 1;
+  c->pwm  = 0;
+} // setup_potctl
+
+//
+// Map an A/D value straight to a signed speed: no filter, no hysteresis
+//
+int potctl_ideal(int adc)
+{
+  if (adc >= 512)
+    return (adc-512)*2;
+  return -(1023-(adc * 2));
+} // potctl_ideal
+
+//
+// One step: returns the PWM value, c->fwd holds the direction
+//
+int potctl_step(struct potctl *c, int adc)
+{ int v, fwd;
+
+  v = ema(&c->filter, adc);
+  // Only change direction once the pot is well past the middle, so
+  // noise around 511/512 does not make the motor switch all the time.
+  fwd = hysteresis(c->fwd, v, 512, c->band);
+  if (fwd)
+  { // map A/D value of 512 to 1023 to going "forwards" -- at 512 (middle)
+    // motor is stopped (v sent to PWM is near 0), as we increase A/D value
+    // motor speed increases (in the "forwards" direction), and when A/D
+    // value is at 1023 (at the "other" end of your pot), we send PWM a
+    // value near 1023 so it goes very fast "forwards".
+    v = (v-512)*2;
+  }
+  else
+  { // map 0 to 511 to going "backwards" -- 0 (one end of your pot) means
+    // go backwards fast (v sent to PWM is near 1023), as we increase 
+    // towards 510, motor speed slows, and at 511 (middle) motor is stopped
+    // (v sent to PWM is near 0)
+    v = 1023-(v * 2);
+  }
+  if (v < 0)
+    v = 0; // inside the hysteresis band on the other side: stopped
+
+  if (c->slew > 0)
+  { // a direction change starts from 0
+    if (fwd != c->fwd)
+      c->pwm = 0;
+    if (v > c->pwm + c->slew) v = c->pwm + c->slew;
+    if (v < c->pwm - c->slew) v = c->pwm - c->slew;
+  }
+  c->fwd = fwd;
+  c->pwm = v;
+  return v;
+} // potctl_step
@@ -41,6 +41,12 @@
 //    and then enable it again.
 // 3/ The output polarity and reverse polarity bits are effective also if
 //    the PWM is disabled but not of there is no clock
+// 4/ Because of 1/ you can not see when a value written to PWM0_DATA has
+//    arrived. A value written to the FIFO can: the PWM takes it out at
+//    the start of a period and the FIFO empty flag comes on. With
+//    PWM0_REPEATFF the PWM keeps using that value until the next one.
+//    update_pwm0 uses this to change the value (and polarity) without
+//    switching the PWM off and to measure how long that took.
 
 // This is how we control a motor with a single PWM channel:
 //
@@ -85,8 +91,26 @@
 //
 
 #include "gb_common.h"
+#include "gb_clk.h"
 #include "gb_pwm.h"
 
+// PWM clock frequency and the range of each channel
+// used to clamp values and for time-outs
+static double   pwm_clk_hz;
+static unsigned pwm_range[2];
+// value set_pwm could not write yet, -1 if none
+static int      pwm_pending[2] = {-1, -1};
+
+//
+// (Re)start the PWM clock from the crystal
+// divi.divf/4096 is the divider, mash 0 for an integer divider
+//
+static void pwm_clock(unsigned divi, unsigned divf, int mash)
+{
+  start_clock(CLK_PWM, CLK_SRC_OSC, divi, divf, mash);
+  pwm_clk_hz = CLK_OSC_HZ / (divi + divf/4096.0);
+} // pwm_clock
+
 
 //
 // Setup the Pulse Width Modulator
@@ -97,58 +121,283 @@ void setup_pwm()
    // Derive PWM clock direct from X-tal
    // thus any system auto-slow-down-clock-to-save-power does not effect it
    // The values below depends on the X-tal frequency!
-   PWMCLK_DIV  = 0x5A000000 | (32<<12); // set pwm div to 32 (19.2/3 = 600KHz)
-   PWMCLK_CNTL = 0x5A000011; // Source=osc and enable
-
    // Make sure PWM is off 
    PWM_CONTROL = 0;  short_wait();
 
+   pwm_clock(32, 0, 0); // set pwm div to 32 (19.2/3 = 600KHz)
+
    // I use 1024 steps for the PWM
    // (Just a nice value which I happen to like)
-   PWM0_RANGE = 0x400;  short_wait();
-
+   set_pwm_range(0, 0x400);
+   set_pwm_range(1, 0x400);
 } // setup_pwm
 
+//
+// Run the PWM clock itself at (close to) hz, e.g. as bit clock for
+// the serial mode. Uses an integer divider if that is within 0.1%,
+// otherwise the fractional one. Returns the clock obtained, 0 if hz
+// is out of reach. Stops the PWM channels.
+//
+double set_pwm_clock(double hz)
+{
+  PWM_CONTROL = 0;  short_wait();
+  pwm_clk_hz = setup_clock(CLK_PWM, CLK_SRC_OSC, hz, -1);
+  return pwm_clk_hz;
+} // set_pwm_clock
+
+//
+// Set up the PWM clock and range of both channels for a PWM
+// frequency as close as possible to target_hz with at least
+// min_resolution steps.
+//
+// PWM frequency = 19.2MHz / divider / range
+// An integer divider gives a clean clock. If no integer divider
+// comes within 0.1% we also try the fractional divider (MASH 1):
+// its clock jitters by one crystal period but on average it is
+// spot on. For equal frequency errors the larger range wins.
+//
+// Returns the frequency obtained and the range in *resolution,
+// or 0 if min_resolution steps can not be done at that frequency.
+// The PWM channels are stopped; set them up again after this.
+//
+double gb_pwm_configure(double target_hz, unsigned min_resolution,
+                        unsigned *resolution)
+{ double total, err, best_err, d;
+  unsigned divi, divf, range;
+  unsigned best_divi, best_divf, best_range;
+
+  if (target_hz <= 0 || min_resolution < 1)
+    return 0;
+  total = CLK_OSC_HZ / target_hz; // divider * range
+  best_err = -1;
+  best_divi = best_divf = best_range = 0;
+
+  // integer divider
+  for (divi = 1; divi <= 4095; divi++)
+  { d = total / divi + 0.5;
+    if (d < min_resolution || d > 0xFFFFFFFF)
+      continue;
+    range = (unsigned)d;
+    err = CLK_OSC_HZ / ((double)divi * range) - target_hz;
+    if (err < 0) err = -err;
+    if (best_err < 0 || err < best_err ||
+        (err == best_err && range > best_range))
+    { best_err = err;
+      best_divi = divi; best_divf = 0; best_range = range;
+    }
+  }
+
+  if (best_err < 0 || best_err > target_hz / 1000)
+  { // fractional divider: for every integer part take the largest
+    // range that still fits and round the fraction
+    for (divi = 2; divi <= 4094; divi++)
+    { d = total / divi;
+      if (d < min_resolution || d > 0xFFFFFFFF)
+        continue;
+      range = (unsigned)d;
+      divf = (unsigned)((total / range - divi) * 4096 + 0.5);
+      if (divf > 4095)
+        continue;
+      err = CLK_OSC_HZ / ((divi + divf/4096.0) * range) - target_hz;
+      if (err < 0) err = -err;
+      if (best_err < 0 || err < best_err ||
+          (err == best_err && range > best_range))
+      { best_err = err;
+        best_divi = divi; best_divf = divf; best_range = range;
+      }
+    }
+  }
+  if (best_err < 0)
+    return 0;
+
+  PWM_CONTROL = 0;  short_wait();
+  pwm_clock(best_divi, best_divf, best_divf ? 1 : 0);
+  set_pwm_range(0, best_range);
+  set_pwm_range(1, best_range);
+  if (resolution)
+    *resolution = best_range;
+  return pwm_clk_hz / best_range;
+} // gb_pwm_configure
+
+//
+// Length of one period of a channel
+//
+static unsigned long long pwm_period_ns(int ch)
+{
+  if (pwm_clk_hz <= 0)
+    return 0;
+  return (unsigned long long)(pwm_range[ch] * 1e9 / pwm_clk_hz);
+} // pwm_period_ns
+
+//
+// Set the number of steps of a channel
+// Values for the channel go from 0 to range (inclusive)
+//
+void set_pwm_range(int ch, unsigned range)
+{
+  ch &= 1;
+  pwm_range[ch] = range;
+  PWM_RANGE(ch) = range;  short_wait();
+} // set_pwm_range
+
+//
+// Set the mode bits of one channel, leaving the other channel alone
+// mode uses the PWM0_... bits for both channels
+//
+void set_pwm_mode(int ch, int mode)
+{ unsigned shift;
+  ch &= 1;
+  shift = 8*ch;
+  PWM_CONTROL = (PWM_CONTROL & ~(PWM_CHAN_BITS << shift))
+              | ((mode & PWM_CHAN_BITS) << shift);
+  short_wait();
+} // set_pwm_mode
+
 //
 // Set PWM value
 // This routine does not wait for the value to arrive
 // If a new value comes in before it is picked up by the chip
 // it will definitely be too fast for the motor to respond to it
+// When the channel runs from the FIFO (after update_pwm) the value
+// is only written if the previous one has been picked up, so the PWM
+// never lags behind a caller which updates faster than the PWM period.
+// Otherwise the value is kept as pending, replacing an older pending
+// one, and flush_pwm() writes it once there is room. A caller which
+// writes again soon does not need that: its next value wins anyway.
+// Returns 1 if the value was written, 0 if it is pending.
 //
-void set_pwm0(int v)
+int set_pwm(int ch, int v)
 { // make sure value is in safe range
+  ch &= 1;
+  if (v<0) v=0;
+  if (v>(int)pwm_range[ch]) v=pwm_range[ch];
+  if (PWM_CONTROL & (PWM0_USEFIFO << 8*ch))
+  { if (!(PWM_STATUS & PWMS_EMPTY))
+    { pwm_pending[ch] = v;
+      return 0;
+    }
+    PWM_FIFO = v;
+  }
+  else
+    PWM_DATA(ch) = v;
+  pwm_pending[ch] = -1;
+  return 1;
+} // set_pwm
+
+//
+// Write the value set_pwm() could not write yet, if there is room now
+// Returns 1 if nothing is pending any more
+//
+int flush_pwm(int ch)
+{ int v;
+  ch &= 1;
+  if (pwm_pending[ch] < 0)
+    return 1;
+  v = pwm_pending[ch];
+  return set_pwm(ch, v);
+} // flush_pwm
+
+//
+// Update PWM value and mode without switching the PWM off
+// The value goes through the FIFO (with repeat on) and we wait
+// until the PWM has taken it out, which happens at the start of the
+// next period. A mode change (e.g. PWM0_REVPOLAR) is written in the
+// same go, the bits of the other channel are left alone.
+// mode uses the PWM0_... bits for both channels.
+//
+// There is only one FIFO. If the other channel already uses it the
+// value goes to the data register instead, it is picked up at the end
+// of the period just the same but we can not see when.
+//
+// Returns the number of ns until the value was in use (0 if that
+// can not be seen), or -1 if it did not arrive (no clock, bus error)
+//
+long update_pwm(int ch, int v, int mode)
+{ unsigned ctrl, mode_ch, shift;
+  unsigned long long t0, timeout;
+
+  ch &= 1;
+  shift = 8*ch;
+  pwm_pending[ch] = -1; // this value is newer
+  // make sure value is in safe range
   if (v<0) v=0;
-  if (v>0x400) v=0x400;
-  PWM0_DATA = v;
+  if (v>(int)pwm_range[ch]) v=pwm_range[ch];
+
+  ctrl = PWM_CONTROL;
+  if (!(mode & PWM0_ENABLE) || (ctrl & (PWM0_USEFIFO << (8-shift))))
+  { // switching off (no period will pick the value up)
+    // or the FIFO belongs to the other channel
+    set_pwm_mode(ch, mode & ~PWM0_USEFIFO);
+    PWM_DATA(ch) = v;
+    return 0;
+  }
+  mode_ch = ((mode & PWM_CHAN_BITS) | PWM0_USEFIFO | PWM0_REPEATFF) << shift;
+
+  // clear old error flags
+  PWM_STATUS = PWMS_BUSERR | (PWMS_GAP0 << ch) | PWMS_RDERR | PWMS_WRERR;
+  if (!(ctrl & (PWM0_USEFIFO << shift)))
+  { // first update: throw out old FIFO contents
+    PWM_CONTROL = ctrl | PWM_CLRFIFO;
+    short_wait();
+  }
+
+  timeout = 4 * pwm_period_ns(ch) + 1000000;
+  t0 = get_time_ns();
+  // a caller using set_pwm may still have one value in the FIFO
+  while (PWM_STATUS & PWMS_FULL)
+    if (get_time_ns() - t0 > timeout)
+      return -1;
+  PWM_FIFO = v;
+  if ((ctrl & (PWM_CHAN_BITS << shift)) != mode_ch)
+    PWM_CONTROL = (ctrl & ~(PWM_CHAN_BITS << shift)) | mode_ch;
+
+  // the value is in use once it has left the FIFO
+  while (!(PWM_STATUS & PWMS_EMPTY))
+    if (get_time_ns() - t0 > timeout)
+      return -1;
+  if (PWM_STATUS & PWMS_BUSERR)
+  { PWM_STATUS = PWMS_BUSERR;
+    return -1;
+  }
+  return (long)(get_time_ns() - t0);
+} // update_pwm
+
+//
+// Channel 0 versions, as used by the motor programs
+//
+int set_pwm0(int v)
+{
+  return set_pwm(0, v);
 } // set_pwm0
 
+long update_pwm0(int v,int mode)
+{
+  return update_pwm(0, v, mode);
+} // update_pwm0
+
 //
 // Force PWM value update
 // This routine makes sure the new value goes in.
-// This is done by dis-abling the PWM, write the value
-// and enable it again. This routine is weak as it
-// uses a delay which is tested (but not guaranteed)
-// Controls channel 0 only.
+// It used to disable the PWM, write the value and enable it again
+// using a delay which was tested (but not guaranteed). Now it is
+// update_pwm without the latency.
 //
-void force_pwm0(int v,int mode)
-{ int w;
-  // disable
-  PWM_CONTROL  = 0;
-  // wait for this command to get to the PWM clock domain
-  // that depends on PWN clock speed
-  // unfortunately there is no way to know when this has happened :-(
-  short_wait();
-  // make sure value is in safe range
-  if (v<0) v=0;
-  if (v>0x400) v=0x400;
-  PWM0_DATA = v;
-  short_wait();
+void force_pwm(int ch,int v,int mode)
+{
+  (void) update_pwm(ch, v, mode);
+} // force_pwm
 
-  PWM_CONTROL  = mode;
-  short_wait();
+void force_pwm0(int v,int mode)
+{
+  force_pwm(0, v, mode);
 } // force_pwm0
 
 void pwm_off()
 {
-  force_pwm0(0,0);
+  // both channels off and back to the data registers
+  PWM_CONTROL = 0;
+  short_wait();
+  PWM0_DATA = 0;
+  PWM1_DATA = 0;
+  pwm_pending[0] = pwm_pending[1] = -1;
 }
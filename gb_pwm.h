@@ -25,6 +25,7 @@
 //
 
 
+// The PWM clock is set up through gb_clk.c
 #define PWMCLK_CNTL  *(clk+40)
 #define PWMCLK_DIV   *(clk+41)
 
@@ -33,6 +34,10 @@
 #define PWM0_RANGE  *(pwm+4)
 #define PWM1_RANGE  *(pwm+8)
 #define PWM0_DATA   *(pwm+5)
+#define PWM_FIFO    *(pwm+6)
+// range and data register of channel 0 or 1
+#define PWM_RANGE(ch) *(pwm+4+4*(ch))
+#define PWM_DATA(ch)  *(pwm+5+4*(ch))
 #define PWM1_DATA   *(pwm+9)
 
 // PWM Control register bits
@@ -54,11 +59,39 @@
 
 #define PWM_CLRFIFO     0x0040  // Clear FIFO (Self clearing bit)
 
+// The PWM1_... bits are the PWM0_... bits shifted up by 8. The channel
+// routines below take the PWM0_... bits and shift them themselves.
+#define PWM_CHAN_BITS   0x00BF
+
 // PWM status bits I need
 #define PWMS_BUSERR     0x0100  // Register access was too fast
-// (Write to clear it)
+#define PWMS_STA0       0x0200  // Channel 0 is transmitting
+#define PWMS_GAP0       0x0010  // Channel 0 ran out of data
+#define PWMS_RDERR      0x0008  // FIFO read when empty
+#define PWMS_WRERR      0x0004  // FIFO written when full
+#define PWMS_EMPTY      0x0002  // FIFO is empty
+#define PWMS_FULL       0x0001  // FIFO is full
+// (Write to clear the error bits)
 
 // declarations for routines
+// ch is the PWM channel: 0 (GPIO18) or 1 (GPIO13 or GPIO19)
 void setup_pwm();
+double set_pwm_clock(double hz);
+double gb_pwm_configure(double target_hz, unsigned min_resolution,
+                        unsigned *resolution);
+void set_pwm_range(int ch, unsigned range);
+void set_pwm_mode(int ch, int mode);
+// set_pwm does not wait. If the channel runs from the FIFO (after
+// update_pwm) and the PWM has not taken the previous value yet, the
+// new one is kept pending and set_pwm returns 0 instead of 1.
+// flush_pwm writes a pending value once there is room and returns 1
+// when nothing is pending any more. Call it (or set_pwm again) when
+// the last value must arrive; do not time stamp a value that is pending.
+int  set_pwm(int ch, int v);
+int  flush_pwm(int ch);
+long update_pwm(int ch, int v, int mode);
+void force_pwm(int ch, int v, int mode);
+int  set_pwm0(int);
+long update_pwm0(int, int);
 void force_pwm0(int, int);
 void pwm_off();
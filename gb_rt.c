@@ -0,0 +1,181 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Real-time execution profile
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A normal Linux process can be stopped at any moment: by a page fault
+// (e.g. the first time a new part of the stack is used), by another
+// process that the scheduler thinks is more important or by the CPU
+// going into a deep sleep state. For most of the test programs that
+// does not matter, but a control loop which is half way a motor
+// direction change does not want to wait a few milliseconds.
+//
+// setup_rt() is the companion of setup_io(). It is opt-in: the normal
+// programs only call setup_rt_env() which does nothing unless the
+// GB_RT_PRIO environment variable is set, e.g.:
+//
+//   sudo GB_RT_PRIO=80 GB_RT_CPU=0 GB_RT_NOCSTATE=1 ./potmot
+//
+
+#define _GNU_SOURCE
+
+#include "gb_common.h"
+#include "gb_rt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PAGE_SIZE     (4*1024)
+#define PREFAULT_STACK (256*1024)  // how much stack we make sure is mapped
+
+static int dma_latency_fd = -1;
+
+//
+// Touch every page of a buffer so it is mapped in now
+// and not on first use. With memory locked it stays there.
+//
+void prefault(void *buf, unsigned long len)
+{ volatile char *p = (volatile char *)buf;
+  unsigned long i;
+  for (i = 0; i < len; i += PAGE_SIZE)
+    p[i] = p[i];
+  if (len)
+    p[len-1] = p[len-1];
+} // prefault
+
+//
+// Use a large local array so the stack pages get mapped
+// Must not be inlined, else the compiler may drop it.
+//
+static void __attribute__((noinline)) prefault_stack()
+{ char stack[PREFAULT_STACK];
+  memset(stack, 0, sizeof(stack));
+  prefault(stack, sizeof(stack));
+} // prefault_stack
+
+//
+// Apply the real-time execution profile
+// what : RT_xxx bits of the parts to apply
+// prio : SCHED_FIFO priority (1..99)
+// cpu  : CPU to pin this process to
+// Returns the RT_xxx bits which could not be applied.
+// Each failure is also reported so the user knows the
+// worst case latency is not bounded.
+//
+int setup_rt(int what, int prio, int cpu)
+{ struct sched_param sp;
+  cpu_set_t set;
+  int failed, zero;
+
+  failed = 0;
+
+  if (what & RT_LOCK_MEM)
+  { if (mlockall(MCL_CURRENT|MCL_FUTURE))
+    { printf("setup_rt: can't lock memory (%s)\n", strerror(errno));
+      failed |= RT_LOCK_MEM;
+    }
+  }
+
+  if (what & RT_PREFAULT)
+    prefault_stack();
+
+  if (what & RT_AFFINITY)
+  { CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set))
+    { printf("setup_rt: can't run on CPU %d (%s)\n", cpu, strerror(errno));
+      failed |= RT_AFFINITY;
+    }
+  }
+
+  if (what & RT_PRIORITY)
+  { memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = prio;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp))
+    { printf("setup_rt: can't set SCHED_FIFO priority %d (%s)\n",
+             prio, strerror(errno));
+      failed |= RT_PRIORITY;
+    }
+  }
+
+  if (what & RT_NO_CSTATE)
+  { // The request only holds as long as the file is open
+    zero = 0;
+    if (dma_latency_fd < 0)
+      dma_latency_fd = open("/dev/cpu_dma_latency", O_WRONLY);
+    if (dma_latency_fd < 0 ||
+        write(dma_latency_fd, &zero, sizeof(zero)) != sizeof(zero))
+    { printf("setup_rt: can't disable deep C-states (%s)\n", strerror(errno));
+      failed |= RT_NO_CSTATE;
+    }
+  }
+
+  return failed;
+} // setup_rt
+
+//
+// Apply the real-time profile only if the user asked for it:
+// GB_RT_PRIO     : SCHED_FIFO priority, also locks and prefaults memory
+// GB_RT_CPU      : CPU to run on
+// GB_RT_NOCSTATE : if set to 1 keep the CPU out of deep sleep states
+// Returns the RT_xxx bits which could not be applied
+//
+int setup_rt_env()
+{ char *s;
+  int what, prio, cpu;
+
+  if ((s = getenv("GB_RT_PRIO")) == NULL)
+    return 0;
+  prio = atoi(s);
+  what = RT_DEFAULT;
+  cpu  = 0;
+  if ((s = getenv("GB_RT_CPU")) != NULL)
+  { cpu = atoi(s);
+    what |= RT_AFFINITY;
+  }
+  if ((s = getenv("GB_RT_NOCSTATE")) != NULL && atoi(s))
+    what |= RT_NO_CSTATE;
+  return setup_rt(what, prio, cpu);
+} // setup_rt_env
+
+//
+// Undo what we did above (as far as needed)
+//
+void restore_rt()
+{ struct sched_param sp;
+
+  if (dma_latency_fd >= 0)
+  { close(dma_latency_fd);
+    dma_latency_fd = -1;
+  }
+  memset(&sp, 0, sizeof(sp));
+  sched_setscheduler(0, SCHED_OTHER, &sp);
+  munlockall();
+} // restore_rt
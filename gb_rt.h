@@ -0,0 +1,40 @@
+//
+// Gertboard test suite
+//
+// real-time execution profile header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// Parts of the real-time profile.
+// setup_rt() returns the bits of the parts it could NOT apply.
+#define RT_LOCK_MEM     0x01  // mlockall current and future pages
+#define RT_PREFAULT     0x02  // touch the stack so it is mapped in
+#define RT_PRIORITY     0x04  // SCHED_FIFO with the given priority
+#define RT_AFFINITY     0x08  // run on one CPU only
+#define RT_NO_CSTATE    0x10  // keep /dev/cpu_dma_latency at 0
+
+#define RT_DEFAULT (RT_LOCK_MEM|RT_PREFAULT|RT_PRIORITY)
+
+int  setup_rt(int what, int prio, int cpu);
+int  setup_rt_env();
+void restore_rt();
+void prefault(void *buf, unsigned long len);
@@ -50,14 +50,15 @@ void setup_spi()
 } // setup_spi()
 
 //
-// Read a value from one of the two ADC channels
+// Start reading one of the two ADC channels and return at once.
+// The transfer is done when spi_done() says so, then call finish_adc().
+// read_adc() does all three and waits.
 //
 // To understand this code you had better read the
 // datasheet of the AD chip (MCP3002)
 //
-int read_adc(int chan) // 'chan' must be 0 or 1. This is not checked!
-{ unsigned char v1,v2,rec_c;
-  int status,w;
+void start_adc(int chan) // 'chan' must be 0 or 1. This is not checked!
+{ unsigned char v1;
   // Set up for single ended, MS comes out first
   v1 = 0xD0 | (chan<<5);
   // Delay to make sure chip select is high for a short while
@@ -72,12 +73,19 @@ int read_adc(int chan) // 'chan' must be 0 or 1. This is not checked!
   // folowed by a dummy byte
   SPI0_FIFO = v1;
   SPI0_FIFO = 0; // dummy
+} // start_adc
 
-  // wait for SPI to be ready
-  // This will take about 16 micro seconds
-  do {
-     status = SPI0_CNTLSTAT;
-  } while ((status & SPI0_CS_DONE)==0);
+//
+// Returns 1 when the transfer has finished
+// This will take about 16 micro seconds
+//
+int spi_done()
+{
+  return (SPI0_CNTLSTAT & SPI0_CS_DONE) != 0;
+} // spi_done
+
+int finish_adc()
+{ unsigned char v1,v2;
   SPI0_CNTLSTAT = SPI0_CS_DONE; // clear the done bit
 
   // Data from the ADC chip should now be in the receiver
@@ -90,8 +98,48 @@ int read_adc(int chan) // 'chan' must be 0 or 1. This is not checked!
   // So I might have my SPI clock/data pahse wrong.
   // For now its easier to dadpt the results (running out of time)
   return ( (v1<<7) | (v2>>1) ) & 0x3FF;
+} // finish_adc
+
+//
+// Read a value from one of the two ADC channels
+//
+int read_adc(int chan) // 'chan' must be 0 or 1. This is not checked!
+{
+  start_adc(chan);
+
+  // wait for SPI to be ready
+  while (!spi_done())
+    ;
+  return finish_adc();
 } // read_adc
 
+//
+// Read 'n' values from one ADC channel as fast as we can into buf
+// The ADC needs its chip select to go high between conversions, so
+// every value is still a transfer of its own, but we do not wait in
+// between: clearing the done bit lets CS go high and reading the two
+// bytes out of the FIFO takes longer than the 310ns the chip needs.
+//
+void read_adc_block(int chan, int *buf, int n) // 'chan' must be 0 or 1
+{ unsigned char v1,v2;
+  int i;
+
+  short_wait();
+  for (i = 0; i < n; i++)
+  {
+    SPI0_CNTLSTAT = SPI0_CS_CHIPSEL0|SPI0_CS_ACTIVATE;
+    SPI0_FIFO = 0xD0 | (chan<<5);
+    SPI0_FIFO = 0; // dummy
+    while (!(SPI0_CNTLSTAT & SPI0_CS_DONE))
+      ;
+    SPI0_CNTLSTAT = SPI0_CS_DONE; // clear the done bit, CS goes high
+    v1 = SPI0_FIFO;
+    v2 = SPI0_FIFO;
+    // same bit positions as finish_adc()
+    buf[i] = ( (v1<<7) | (v2>>1) ) & 0x3FF;
+  }
+} // read_adc_block
+
 //
 // Write 12 bit value to DAC channel 0 or 1
 //
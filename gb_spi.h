@@ -60,4 +60,8 @@
 
 void setup_spi(void);
 int read_adc(int);
+void start_adc(int);
+int spi_done(void);
+int finish_adc(void);
+void read_adc_block(int, int *, int);
 void write_dac(int, int);
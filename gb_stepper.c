@@ -0,0 +1,242 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Unipolar stepper motor on the open collector drivers
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A unipolar stepper has four coils (plus a common wire to the supply).
+// Connect them to four of the open collector drivers; switching the
+// coils on in the right order makes the motor step:
+//
+//   full step (two coils on, most torque) : 1100 0110 0011 1001
+//   half step (one and two coils in turn) : 1000 1100 0100 0110
+//                                           0010 0011 0001 1001
+// (coil 1 is the leftmost bit). The four GPIOs form a pin group (see
+// gb_pins.c) so every step is one clear and one set write.
+//
+// A motor can not start at full speed, so we accelerate: the time
+// between steps starts long and gets shorter until the maximum rate,
+// and the other way round at the end of a move. The intervals come
+// from the approximation by D. Austin (constant acceleration):
+//
+//   c0 = 0.676 * sqrt(2 / accel)      cn = c(n-1) - 2 c(n-1) / (4n + 1)
+//
+// They are worked out once in setup_stepper(), the stepper thread only
+// looks them up. Every step has an absolute deadline (previous deadline
+// plus interval, see wait_until_ns) so a late wake-up does not shift
+// the steps after it: a move of millions of steps takes exactly as long
+// as planned.
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_pins.h"
+#include "gb_stepper.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#define MAX_RAMP   1000000  // steps
+#define MOVE_QUEUE 32       // moves, must be a power of 2
+
+static const unsigned full_step[4] = {0x3, 0x6, 0xC, 0x9};
+static const unsigned half_step[8] = {0x1, 0x3, 0x2, 0x6, 0x4, 0xC, 0x8, 0x9};
+
+static struct pin_group coils;
+static const unsigned *phases;
+static int n_phases, phase;
+
+static unsigned long *ramp;        // interval of step n of a ramp, ns
+static long n_ramp;
+static unsigned long min_interval; // at the maximum rate, ns
+
+static pthread_t stepper;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond = PTHREAD_COND_INITIALIZER;
+static long moves[MOVE_QUEUE];
+static unsigned move_head, move_tail;
+static int moving, stepper_running;
+static unsigned long stepper_spin;
+static struct stepper_stats stats;
+
+//
+// Set up the coils and work out the acceleration ramp
+// pins    : GPIO of coil 1 to 4 (the GPIOs must be outputs)
+// half    : 1 for half steps
+// max_rate: steps per second, accel: steps per second^2
+// If max_rate takes more than MAX_RAMP steps to reach, the motor tops out
+// at the rate of the last ramp step instead
+// Returns 0 on success
+//
+int setup_stepper(const int *pins, int half, double max_rate, double accel)
+{ double c;
+  long n, size;
+
+  if (max_rate <= 0 || accel <= 0)
+    return -1;
+  setup_pin_group(&coils, pins, 4);
+  phases   = half ? half_step : full_step;
+  n_phases = half ? 8 : 4;
+  phase    = 0;
+
+  min_interval = (unsigned long)(1e9 / max_rate);
+  // about rate^2 / (2 accel) steps to reach the maximum rate
+  size = (long)(max_rate * max_rate / (2 * accel) * 1.1) + 16;
+  if (size > MAX_RAMP)
+    size = MAX_RAMP;
+  free(ramp);
+  if ((ramp = malloc(size * sizeof(unsigned long))) == NULL)
+  { printf("allocation error \n");
+    return -1;
+  }
+  c = 0.676 * sqrt(2.0 / accel) * 1e9;
+  for (n = 0; n < size && c > min_interval; n++)
+  { ramp[n] = (unsigned long)(c + 0.5);
+    c -= 2 * c / (4 * (n+1) + 1);
+  }
+  n_ramp = n;
+  // ramp cut short by MAX_RAMP: cruise at the last ramp interval, a jump
+  // straight to min_interval would stall the motor
+  if (c > min_interval)
+    min_interval = ramp[n_ramp-1];
+  memset(&stats, 0, sizeof(stats));
+  return 0;
+} // setup_stepper
+
+static void unlock_queue(void *arg)
+{
+  pthread_mutex_unlock(&lock);
+} // unlock_queue
+
+static void *stepper_thread(void *arg)
+{ unsigned long long next, now;
+  long steps, k, idx;
+  int dir;
+  long late;
+
+  next = 0;
+  while (1)
+  { pthread_mutex_lock(&lock);
+    // cond_wait is where stop_stepper() cancels us: give back the lock
+    pthread_cleanup_push(unlock_queue, NULL);
+    moving = 0;
+    pthread_cond_broadcast(&cond);  // for wait_stepper()
+    while (move_head == move_tail)
+    { pthread_cond_wait(&cond, &lock);
+      next = 0;  // we have been idle: start from now
+    }
+    steps = moves[move_tail & (MOVE_QUEUE-1)];
+    move_tail++;
+    moving = 1;
+    pthread_cleanup_pop(1);
+
+    dir = steps < 0 ? n_phases-1 : 1;
+    if (steps < 0)
+      steps = -steps;
+    if (!next)
+      next = get_time_ns();
+    for (k = 0; k < steps; k++)
+    { // accelerate at the start, slow down at the end
+      idx = k < steps-1-k ? k : steps-1-k;
+      next += idx < n_ramp ? ramp[idx] : min_interval;
+      wait_until_ns(next, stepper_spin);
+      phase = (phase + dir) % n_phases;
+      write_pin_group(&coils, phases[phase]);
+      now = get_time_ns();
+      late = (long)(now - next);
+      stats.steps++;
+      stats.late_sum += late;
+      if (late > stats.late_max)
+        stats.late_max = late;
+    }
+  }
+  return NULL;
+} // stepper_thread
+
+//
+// Start the stepper thread, the coils of the first phase go on
+// spin : ns to busy-wait before each step (0 = sleep only)
+// Call setup_rt() first to give the thread real-time priority.
+// Returns 0 on success
+//
+int start_stepper(unsigned long spin)
+{
+  stepper_spin = spin;
+  move_head = move_tail = 0;
+  write_pin_group(&coils, phases[phase]);
+  if (pthread_create(&stepper, NULL, stepper_thread, NULL))
+  { printf("Can't start the stepper thread\n");
+    return -1;
+  }
+  stepper_running = 1;
+  return 0;
+} // start_stepper
+
+//
+// Queue a move of 'steps' steps (negative: the other way)
+// It starts right after the moves queued before it.
+// Returns -1 if the queue is full
+//
+int queue_steps(long steps)
+{
+  pthread_mutex_lock(&lock);
+  if (move_head - move_tail >= MOVE_QUEUE)
+  { pthread_mutex_unlock(&lock);
+    return -1;
+  }
+  moves[move_head & (MOVE_QUEUE-1)] = steps;
+  move_head++;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  return 0;
+} // queue_steps
+
+//
+// Wait until all queued moves are done
+//
+void wait_stepper()
+{
+  pthread_mutex_lock(&lock);
+  while (move_head != move_tail || moving)
+    pthread_cond_wait(&cond, &lock);
+  pthread_mutex_unlock(&lock);
+} // wait_stepper
+
+//
+// Stop where we are and switch all coils off
+//
+void stop_stepper(struct stepper_stats *st)
+{
+  if (stepper_running)
+  { pthread_cancel(stepper);
+    pthread_join(stepper, NULL);
+    stepper_running = 0;
+  }
+  write_pin_group(&coils, 0);
+  if (st)
+    *st = stats;
+} // stop_stepper
@@ -0,0 +1,328 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Stream samples from a file through the PWM FIFO
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// The PWM can take its values from a small FIFO instead of the data
+// registers. Every PWM period takes one word out of it (with both
+// channels on the FIFO the words go to channel 0 and 1 in turn). So
+// if we set the PWM period to the sample period of a sound file and
+// keep the FIFO filled, the PWM plays the file. Put a low-pass filter
+// (or a small speaker) on GPIO18 and you hear it.
+//
+// In serial mode the PWM shifts out the 32 bits of every FIFO word
+// instead, MSB first at the PWM clock rate. A file of 32-bit words is
+// then played as an arbitrary bit pattern.
+//
+// The file is memory-mapped so there are no read calls while playing.
+// A feeder thread fills the FIFO until it is full and then sleeps for
+// the time it takes the PWM to use half of it, so the CPU wakes up
+// once per PWM_FIFO_DEPTH/2 words instead of once per sample.
+// If the thread is late the PWM runs out of words; the PWM status
+// register tells us (gap flags) and we count these underruns. Run the
+// program with a real-time priority to avoid them at high rates.
+//
+// Compile with -pthread
+//
+
+// the file size for fstat, also on a 32-bit Raspberry Pi
+#define _FILE_OFFSET_BITS 64
+
+#include "gb_common.h"
+#include "gb_pwm.h"
+#include "gb_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PWM_FIFO_DEPTH 8     // words
+#define FEED_SPIN      20000 // ns, see wait_until_ns
+
+static unsigned char *map;
+static size_t map_len;
+static const unsigned char *data; // first sample
+static unsigned long frames;      // samples per channel in the file
+static int in_bits, in_chans, frame_bytes;
+
+static struct pwm_stream cfg;
+static unsigned range;
+static int outs[2], nout;         // PWM channel of every FIFO word
+static unsigned long long word_ns;
+static pthread_t feed_thread;
+static volatile int streaming;
+static struct stream_stats stats;
+
+static unsigned get16(const unsigned char *p)
+{
+  return p[0] | (p[1]<<8);
+} // get16
+
+static unsigned get32(const unsigned char *p)
+{
+  return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned)p[3]<<24);
+} // get32
+
+//
+// Find the format and the samples in a WAV file
+// Returns 0 if it is a PCM WAV file we can play
+//
+static int parse_wav()
+{ const unsigned char *p, *end;
+  unsigned size;
+  int have_fmt;
+
+  if (map_len < 12 || memcmp(map, "RIFF", 4) || memcmp(map+8, "WAVE", 4))
+    return -1;
+  have_fmt = 0;
+  p   = map + 12;
+  end = map + map_len;
+  while (p + 8 <= end)
+  { size = get32(p+4);
+    if (!memcmp(p, "fmt ", 4) && size >= 16 && p + 8 + 16 <= end)
+    { if (get16(p+8) != 1) // PCM
+      { printf("Only PCM WAV files are supported\n");
+        return -1;
+      }
+      in_chans = get16(p+10);
+      cfg.rate = get32(p+12);
+      in_bits  = get16(p+22);
+      have_fmt = 1;
+    }
+    else if (!memcmp(p, "data", 4) && have_fmt)
+    { data = p + 8;
+      if (size > (unsigned)(end - data))
+        size = end - data;
+      frame_bytes = in_chans * in_bits / 8;
+      if (frame_bytes <= 0)
+        return -1;
+      frames = size / frame_bytes;
+      return 0;
+    }
+    p += 8 + size + (size & 1); // chunks are padded to an even size
+  }
+  return -1;
+} // parse_wav
+
+//
+// The FIFO word for PWM channel ch of a frame
+//
+static unsigned sample(unsigned long frame, int ch)
+{ const unsigned char *p;
+
+  // a mono file goes to both channels
+  p = data + frame * frame_bytes + (in_chans > 1 ? ch : 0) * (in_bits/8);
+  if (cfg.serial)
+    return get32(p);
+  if (in_bits == 8)
+    return p[0] * range / 255;
+  // signed 16 bits
+  return (unsigned)(((int)(short)get16(p) + 32768) * (unsigned long long)range / 65535);
+} // sample
+
+//
+// Write words to the FIFO until it is full
+// Returns 1 at the end of the file (unless looping)
+//
+static unsigned long frame; // next frame to write
+static int k;               // next channel of that frame
+
+static int fill()
+{
+  while (!(PWM_STATUS & PWMS_FULL))
+  { PWM_FIFO = sample(frame, outs[k]);
+    stats.words++;
+    if (++k == nout)
+    { k = 0;
+      if (++frame == frames)
+      { frame = 0;
+        if (!cfg.loop)
+          return 1;
+      }
+    }
+  }
+  return 0;
+} // fill
+
+//
+// Keep the FIFO filled until the end of the file (or until stopped)
+//
+static void *feed(void *arg)
+{ unsigned long long t0, half;
+  unsigned mode, ctrl, gaps;
+  int i, done;
+
+  half = PWM_FIFO_DEPTH/2 * word_ns;
+  gaps = PWMS_GAP0 | (PWMS_GAP0 << 1);
+  frame = 0;
+  k = 0;
+
+  // fill the FIFO before the channels start
+  done = fill();
+  mode = PWM0_USEFIFO | PWM0_ENABLE;
+  mode |= cfg.serial ? PWM0_SERIAL : PWM0_REPEATFF;
+  ctrl = 0;
+  for (i = 0; i < nout; i++)
+    ctrl |= mode << 8*outs[i];
+  PWM_CONTROL = ctrl;
+  PWM_STATUS = gaps | PWMS_BUSERR | PWMS_RDERR | PWMS_WRERR;
+  t0 = get_time_ns();
+
+  while (streaming && !done)
+  { wait_until_ns(get_time_ns() + half, FEED_SPIN);
+    if (PWM_STATUS & gaps)
+    { stats.underruns++;
+      PWM_STATUS = gaps;
+    }
+    stats.refills++;
+    done = fill();
+  }
+
+  // let the PWM play what is left in the FIFO
+  while (streaming && !(PWM_STATUS & PWMS_EMPTY))
+    wait_until_ns(get_time_ns() + half, FEED_SPIN);
+  wait_until_ns(get_time_ns() + 2*word_ns, FEED_SPIN);
+  stats.ns = get_time_ns() - t0;
+  streaming = 0;
+  return NULL;
+} // feed
+
+//
+// Start playing a WAV file (or a raw file set up by ps) on the PWM
+// min_resolution: minimum number of PWM steps per sample
+// Returns 0 if playing
+//
+int start_stream(const char *file, const struct pwm_stream *ps,
+                 unsigned min_resolution)
+{ struct stat sb;
+  int fd, i;
+
+  cfg = *ps;
+  if ((fd = open(file, O_RDONLY)) < 0)
+  { printf("Can't open %s\n", file);
+    return -1;
+  }
+  if (fstat(fd, &sb) || sb.st_size == 0)
+  { printf("Can't read %s\n", file);
+    close(fd);
+    return -1;
+  }
+  map_len = sb.st_size;
+  // read the whole file in now, not while playing
+  map = (unsigned char *)mmap(NULL, map_len, PROT_READ,
+                              MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  { printf("Can't map %s\n", file);
+    return -1;
+  }
+
+  if (cfg.serial || parse_wav())
+  { // raw file
+    data     = map;
+    in_bits  = cfg.serial ? 32 : cfg.bits;
+    in_chans = cfg.channels;
+    if ((in_bits != 8 && in_bits != 16 && in_bits != 32) ||
+        in_chans < 1 || in_chans > 2)
+    { printf("Raw files need 8 or 16 bits and 1 or 2 channels\n");
+      munmap(map, map_len);
+      return -1;
+    }
+    frame_bytes = in_chans * in_bits / 8;
+    frames = map_len / frame_bytes;
+  }
+  else if ((in_bits != 8 && in_bits != 16) || in_chans < 1 || in_chans > 2)
+  { printf("Only 8 or 16 bit, mono or stereo WAV files are supported\n");
+    munmap(map, map_len);
+    return -1;
+  }
+  if (frames == 0)
+  { printf("%s has no samples\n", file);
+    munmap(map, map_len);
+    return -1;
+  }
+
+  nout = 0;
+  if (cfg.out & 1) outs[nout++] = 0;
+  if (cfg.out & 2) outs[nout++] = 1;
+  if (nout == 0)
+    outs[nout++] = 0;
+
+  memset(&stats, 0, sizeof(stats));
+  if (cfg.serial)
+  { // the PWM clock is the bit clock, every word is 32 bits
+    stats.hz = set_pwm_clock(cfg.rate);
+    range = 32;
+    for (i = 0; i < nout; i++)
+      set_pwm_range(outs[i], range);
+    word_ns = stats.hz > 0 ? (unsigned long long)(32e9 / stats.hz / nout) : 0;
+  }
+  else
+  { stats.hz = gb_pwm_configure(cfg.rate, min_resolution, &range);
+    word_ns = stats.hz > 0 ? (unsigned long long)(1e9 / stats.hz / nout) : 0;
+  }
+  if (stats.hz <= 0)
+  { printf("Can't do %.0f Hz with the PWM clock\n", cfg.rate);
+    munmap(map, map_len);
+    return -1;
+  }
+  stats.range = range;
+
+  PWM_CONTROL = PWM_CLRFIFO;
+  short_wait();
+  streaming = 1;
+  if (pthread_create(&feed_thread, NULL, feed, NULL))
+  { printf("Can't start the feeder thread\n");
+    streaming = 0;
+    munmap(map, map_len);
+    return -1;
+  }
+  return 0;
+} // start_stream
+
+//
+// Still playing?
+//
+int stream_busy()
+{
+  return streaming;
+} // stream_busy
+
+//
+// Stop playing (or clean up after the end of the file)
+//
+void stop_stream(struct stream_stats *st)
+{
+  streaming = 0;
+  pthread_join(feed_thread, NULL);
+  pwm_off();
+  munmap(map, map_len);
+  if (st)
+    *st = stats;
+} // stop_stream
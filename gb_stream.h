@@ -0,0 +1,50 @@
+//
+// Gertboard test suite
+//
+// PWM FIFO streaming header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// What to play and how (see gb_stream.c)
+struct pwm_stream {
+  int    out;       // PWM channels: 1 = channel 0, 2 = channel 1, 3 = both
+  double rate;      // samples per second (serial: bits per second)
+  int    serial;    // shift out 32-bit words instead of PWM levels
+  int    loop;      // start again at the end of the file
+  // only used for raw files, a WAV file has this in its header
+  int    bits;      // 8 (unsigned) or 16 (signed, little endian)
+  int    channels;  // 1 or 2 (interleaved)
+};
+
+struct stream_stats {
+  unsigned long long words;      // FIFO words written
+  unsigned long long underruns;  // times the PWM found the FIFO empty
+  unsigned long long refills;    // times the feeder thread woke up
+  unsigned long long ns;         // duration of the playback
+  double   hz;                   // sample rate (serial: bit rate) obtained
+  unsigned range;                // PWM steps per sample (serial: 32)
+};
+
+int  start_stream(const char *file, const struct pwm_stream *ps,
+                  unsigned min_resolution);
+int  stream_busy();
+void stop_stream(struct stream_stats *st);
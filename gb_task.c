@@ -0,0 +1,261 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Cooperative tasks: many board jobs in one thread
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Each demo used to be one blocking loop: walk the LEDs with long_wait(),
+// read the buttons in a loop, ... so only one could run at a time.
+// Giving every job its own thread works but then they all need locks
+// around the shared state and the Gertboard registers.
+//
+// Here every job is a task (see gb_task.h): a function which returns
+// to the scheduler whenever it has to wait and continues where it left
+// off when it is called again. All tasks run in one thread, one at a
+// time, so they can share variables without any locking.
+//
+// The scheduler sleeps in epoll_wait() until something happens:
+// - a timerfd set to the earliest time any task waits for
+// - one of the file descriptors tasks wait on (stdin, the pin edges of
+//   gb_edge.c, the eventfd of a gb_event.c reader, a socket...)
+// then calls every task which can continue. With all tasks waiting the
+// CPU is idle. Note that a gb_event.c reader brings its own sampler
+// thread; to wait for a pin in this thread only, use edge_fd().
+//
+// The SPI controller has an interrupt, but not one we can get at from
+// user space. A 2 byte transfer takes 16us so AWAIT_COND simply checks
+// the DONE bit again after a short sleep: that is polling, if slow.
+//
+
+#include "gb_common.h"
+#include "gb_event.h"
+#include "gb_task.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 16
+
+static struct task *tasks, *last_task;
+static int ep = -1, tfd = -1;
+static int stopping;
+static unsigned long wakeups;
+static unsigned long long run_ns;
+
+//
+// Create the epoll set with the timer in it
+// Returns 0 on success
+//
+int setup_tasks()
+{ struct epoll_event ev;
+
+  tasks = last_task = NULL;
+  stopping = 0;
+  wakeups = 0;
+  run_ns = 0;
+  if ((ep = epoll_create1(0)) < 0 ||
+      (tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) < 0)
+  { printf("Can't set up the task scheduler\n");
+    if (ep >= 0)
+      close(ep);
+    ep = -1;
+    return -1;
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;  // NULL is the timer, everything else a task
+  epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+  return 0;
+} // setup_tasks
+
+//
+// Add a task, it starts in the first round of run_tasks()
+//
+void add_task(struct task *t, const char *name,
+              int (*fn)(struct task *t), void *arg)
+{
+  memset(t, 0, sizeof(*t));
+  t->fn   = fn;
+  t->arg  = arg;
+  t->name = name;
+  t->fd   = -1;
+  t->wake = 1;  // long ago: run at once
+  if (last_task)
+    last_task->next = t;
+  else
+    tasks = t;
+  last_task = t;
+} // add_task
+
+//
+// Called by the macros
+//
+void task_arm(struct task *t, long long ns)
+{
+  t->wake = ns < 0 ? 0 : get_time_ns() + ns;
+} // task_arm
+
+int task_expired(struct task *t)
+{
+  if (t->wake && get_time_ns() >= t->wake)
+  { t->result = TASK_TIMEOUT;
+    return 1;
+  }
+  return 0;
+} // task_expired
+
+void task_wait_fd(struct task *t, int fd)
+{
+  t->fd = fd;
+} // task_wait_fd
+
+int task_event(struct task *t, struct event_reader *r, struct gb_event *ev)
+{ unsigned long long cnt;
+  // clear the eventfd first, see gb_next_event()
+  (void) read(r->fd, &cnt, sizeof(cnt));
+  if (gb_poll_event(r, ev))
+  { t->result = TASK_READY;
+    return 1;
+  }
+  return 0;
+} // task_event
+
+//
+// Let a task continue, then register what it waits for
+//
+static void run_task(struct task *t)
+{ struct epoll_event ev;
+
+  if (t->fd >= 0)
+  { epoll_ctl(ep, EPOLL_CTL_DEL, t->fd, NULL);
+    t->fd = -1;
+  }
+  t->result = t->ready ? TASK_READY : TASK_TIMEOUT;
+  t->ready = 0;
+  t->runs++;
+  if (t->fn(t) == TASK_DONE)
+  { t->done = 1;
+    return;
+  }
+  if (t->fd >= 0)
+  { ev.events = EPOLLIN;
+    ev.data.ptr = t;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, t->fd, &ev) < 0)
+      t->ready = 1;  // e.g. a plain file: always readable
+  }
+} // run_task
+
+//
+// Run the tasks until they are all done or one calls stop_tasks()
+// Returns 0, or -1 if setup_tasks() failed
+//
+int run_tasks()
+{ struct epoll_event evs[MAX_EVENTS];
+  struct itimerspec its;
+  unsigned long long now, first, cnt, t0;
+  struct task *t;
+  int i, n, live;
+
+  if (ep < 0)
+    return -1;
+  t0 = get_time_ns();
+  while (!stopping)
+  { // run every task which can continue
+    now = get_time_ns();
+    live = 0;
+    first = 0;
+    for (t = tasks; t && !stopping; t = t->next)
+    { if (t->done)
+        continue;
+      if (t->ready || (t->wake && t->wake <= now))
+        run_task(t);
+      if (t->done)
+        continue;
+      live++;
+      if (t->ready)
+        first = 1;
+      else if (t->wake && (first == 0 || t->wake < first))
+        first = t->wake;
+    }
+    if (live == 0 || stopping)
+      break;
+
+    // sleep until the first time or a file descriptor is ready
+    // (an it_value of 0 stops the timer)
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec  = first / 1000000000ULL;
+    its.it_value.tv_nsec = first % 1000000000ULL;
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+    do {
+      n = epoll_wait(ep, evs, MAX_EVENTS, -1);
+    } while (n < 0 && errno == EINTR);
+    wakeups++;
+    for (i = 0; i < n; i++)
+      if (evs[i].data.ptr == NULL)
+        (void) read(tfd, &cnt, sizeof(cnt));
+      else
+        ((struct task *)evs[i].data.ptr)->ready = 1;
+  }
+
+  for (t = tasks; t; t = t->next)
+    if (t->fd >= 0)
+    { epoll_ctl(ep, EPOLL_CTL_DEL, t->fd, NULL);
+      t->fd = -1;
+    }
+  close(tfd);
+  close(ep);
+  tfd = ep = -1;
+  run_ns = get_time_ns() - t0;
+  return 0;
+} // run_tasks
+
+//
+// Called from a task: run_tasks() returns after this task returns
+//
+void stop_tasks()
+{
+  stopping = 1;
+} // stop_tasks
+
+//
+// How often every task ran and how busy we were
+//
+void print_task_stats()
+{ struct rusage ru;
+  struct task *t;
+  double cpu;
+
+  getrusage(RUSAGE_SELF, &ru);
+  cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+        ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+  printf("%.1f s, %lu wake-ups, process CPU time %.3f s (%.1f%%)\n",
+         run_ns / 1e9, wakeups, cpu, run_ns ? cpu * 1e11 / run_ns : 0);
+  for (t = tasks; t; t = t->next)
+    printf("  %-12s %8lu runs%s\n", t->name ? t->name : "?", t->runs,
+           t->done ? " (done)" : "");
+} // print_task_stats
@@ -0,0 +1,122 @@
+//
+// Gertboard test suite
+//
+// cooperative task scheduler header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// A task is a function which is called again and again. It runs until
+// it has to wait, then returns to the scheduler; next time it continues
+// after the AWAIT_... where it left off. The macros do the bookkeeping
+// with a switch on the line number (like protothreads), so:
+// - local variables are lost at every AWAIT: keep state in a struct
+//   (use 'arg', or put 'struct task' first in your own struct)
+// - do not use switch statements around an AWAIT
+//
+//   static int blink(struct task *t)
+//   {
+//     TASK_BEGIN(t);
+//     while (1)
+//     { GPIO_SET0 = 1<<22;
+//       AWAIT_DELAY(t, 500000000);
+//       GPIO_CLR0 = 1<<22;
+//       AWAIT_DELAY(t, 500000000);
+//     }
+//     TASK_END(t);
+//   }
+
+#define TASK_WAIT 0  // returned by a task which waits
+#define TASK_DONE 1  // returned by a task which has finished
+
+// why a task was woken up (t->result)
+#define TASK_TIMEOUT 0  // the time was up
+#define TASK_READY   1  // the file descriptor or event was ready
+
+struct task {
+  int (*fn)(struct task *t);
+  void *arg;
+  const char *name;
+  int line;                   // where to continue, 0: at the start
+  int done;
+  int result;                 // TASK_TIMEOUT or TASK_READY
+  // what we wait for
+  unsigned long long wake;    // ns (get_time_ns), 0: no time limit
+  int fd;                     // -1: none
+  int ready;                  // set by the scheduler when fd is readable
+  unsigned long runs;         // how often the task was called
+  struct task *next;
+};
+
+// (the code before a 'case' label in the macros below runs into it on
+// purpose, this tells the compiler so)
+#define TASK_FALLTHROUGH __attribute__ ((fallthrough))
+
+#define TASK_BEGIN(t) switch ((t)->line) { case 0:
+#define TASK_END(t)   } (t)->line = 0; return TASK_DONE;
+
+// Continue at absolute time 'deadline' (get_time_ns), no drift when used
+// as deadline += period
+#define AWAIT_UNTIL(t, deadline) \
+  do { (t)->wake = (deadline) ? (deadline) : 1; \
+       (t)->line = __LINE__; return TASK_WAIT; case __LINE__: ; } while (0)
+
+#define AWAIT_DELAY(t, ns) AWAIT_UNTIL(t, get_time_ns() + (ns))
+
+// Let the other tasks run first
+#define TASK_YIELD(t) AWAIT_UNTIL(t, 1)
+
+// Wait until 'fd' can be read, or 'ns' has passed (ns < 0: no limit).
+// Afterwards t->result tells which. One task per fd at a time.
+#define AWAIT_FD(t, fdesc, ns) \
+  do { task_arm(t, ns); task_wait_fd(t, fdesc); \
+       (t)->line = __LINE__; return TASK_WAIT; case __LINE__: ; } while (0)
+
+// Wait for the next event from a gb_event.c reader (or 'ns' passes).
+// t->result is TASK_READY if *ev was filled in
+#define AWAIT_EVENT(t, r, ev, ns) \
+  do { task_arm(t, ns); (t)->line = __LINE__; TASK_FALLTHROUGH; \
+       case __LINE__: \
+       if (task_event(t, r, ev) || task_expired(t)) break; \
+       task_wait_fd(t, (r)->fd); return TASK_WAIT; } while (0)
+
+// For hardware without an interrupt we can see (e.g. SPI DONE):
+// check 'cond' every 'ns' until it is true, sleeping in between
+#define AWAIT_COND(t, cond, ns) \
+  do { (t)->line = __LINE__; TASK_FALLTHROUGH; case __LINE__: \
+       if (cond) break; \
+       (t)->wake = get_time_ns() + (ns); return TASK_WAIT; } while (0)
+
+struct gb_event;
+struct event_reader;
+
+int  setup_tasks();
+void add_task(struct task *t, const char *name,
+              int (*fn)(struct task *t), void *arg);
+int  run_tasks();
+void stop_tasks();
+void print_task_stats();
+
+// used by the macros
+void task_arm(struct task *t, long long ns);
+int  task_expired(struct task *t);
+void task_wait_fd(struct task *t, int fd);
+int  task_event(struct task *t, struct event_reader *r, struct gb_event *ev);
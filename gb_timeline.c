@@ -0,0 +1,232 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// GPIO waveform timeline player
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// A timeline is a list of {time, set mask, clear mask} events. After
+// compile_timeline() it is one array sorted on time, with all events at
+// the same time merged into one, so the player only has to do two
+// register writes per event.
+//
+// The player thread plays timelines one after the other. Every event
+// time is an absolute deadline: start of the timeline + event time. We
+// sleep until just before it (clock_nanosleep TIMER_ABSTIME) and spin
+// the last part, see wait_until_ns(). A late wake-up does not shift the
+// events after it, so there is no drift however long it plays, and the
+// CPU is only used around the events themselves.
+//
+// A timeline can loop. queue_timeline() adds a timeline to play next:
+// it starts exactly when the current one ends (or loop ends).
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_timeline.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+static pthread_t player;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond = PTHREAD_COND_INITIALIZER;
+static struct timeline *queue_head, *queue_tail;
+static struct timeline *playing;
+static int player_running;
+static unsigned long player_spin;
+
+void setup_timeline(struct timeline *tl)
+{
+  memset(tl, 0, sizeof(*tl));
+} // setup_timeline
+
+void free_timeline(struct timeline *tl)
+{
+  free(tl->ev);
+  setup_timeline(tl);
+} // free_timeline
+
+//
+// Add an event, in any order
+// Returns 0 on success, -1 if out of memory
+//
+int timeline_event(struct timeline *tl, unsigned long long t,
+                   unsigned set, unsigned clr)
+{ struct tl_event *ev;
+
+  if (tl->n == tl->size)
+  { tl->size = tl->size ? tl->size*2 : 16;
+    if ((ev = realloc(tl->ev, tl->size * sizeof(*ev))) == NULL)
+      return -1;
+    tl->ev = ev;
+  }
+  tl->ev[tl->n].t   = t;
+  tl->ev[tl->n].set = set;
+  tl->ev[tl->n].clr = clr;
+  tl->n++;
+  return 0;
+} // timeline_event
+
+static int cmp_event(const void *a, const void *b)
+{ const struct tl_event *ea = a, *eb = b;
+  return ea->t < eb->t ? -1 : ea->t > eb->t ? 1 : 0;
+} // cmp_event
+
+//
+// Sort the events and merge events at the same time
+// length : time until the timeline is done (0: time of the last event)
+// loop   : 1 to repeat until another timeline is queued
+// Returns 0, or -1 if it should loop but takes no time (no events or
+// all at 0 and length 0): the player would replay it without ever
+// sleeping. Such a timeline is made to play once.
+//
+int compile_timeline(struct timeline *tl, unsigned long long length,
+                     int loop)
+{ int i, j;
+
+  // qsort is not stable, so same-time events are merged
+  // below in a way that does not depend on their order:
+  // a pin both set and cleared at the same time ends up set
+  qsort(tl->ev, tl->n, sizeof(struct tl_event), cmp_event);
+  for (i = 0, j = -1; i < tl->n; i++)
+  { if (j >= 0 && tl->ev[j].t == tl->ev[i].t)
+    { tl->ev[j].set |= tl->ev[i].set;
+      tl->ev[j].clr |= tl->ev[i].clr;
+    }
+    else
+      tl->ev[++j] = tl->ev[i];
+  }
+  tl->n = j+1;
+  for (i = 0; i < tl->n; i++)
+    tl->ev[i].clr &= ~tl->ev[i].set;  // set wins
+  if (!length && tl->n)
+    length = tl->ev[tl->n-1].t;
+  tl->length = length;
+  tl->loop   = loop && length;
+  return loop && !length ? -1 : 0;
+} // compile_timeline
+
+static void unlock_queue(void *arg)
+{
+  pthread_mutex_unlock(&lock);
+} // unlock_queue
+
+static void *play_thread(void *arg)
+{ unsigned long long base;
+  struct tl_event *ev, *end;
+  struct timeline *tl;
+
+  base = 0;
+  while (1)
+  { pthread_mutex_lock(&lock);
+    // cond_wait is where stop_player() cancels us: give back the lock
+    pthread_cleanup_push(unlock_queue, NULL);
+    if (playing && playing->loop && !queue_head)
+      tl = playing;                 // play it again
+    else
+    { playing = NULL;
+      pthread_cond_broadcast(&cond);  // for wait_player()
+      while (!queue_head)
+      { pthread_cond_wait(&cond, &lock);
+        base = 0;  // we have been idle: start from now
+      }
+      tl = queue_head;
+      queue_head = tl->next;
+      if (!queue_head)
+        queue_tail = NULL;
+      playing = tl;
+    }
+    pthread_cleanup_pop(1);
+
+    if (!base)
+      base = get_time_ns();
+    for (ev = tl->ev, end = tl->ev + tl->n; ev < end; ev++)
+    { wait_until_ns(base + ev->t, player_spin);
+      GPIO_CLR0 = ev->clr;
+      GPIO_SET0 = ev->set;
+    }
+    // the next timeline starts exactly where this one ends
+    base += tl->length;
+    wait_until_ns(base, player_spin);
+  }
+  return NULL;
+} // play_thread
+
+//
+// Start the player thread
+// spin : ns to busy-wait before each event (0 = sleep only)
+// Call setup_rt() first to give the player real-time priority.
+// Returns 0 on success
+//
+int start_player(unsigned long spin)
+{
+  player_spin = spin;
+  queue_head = queue_tail = playing = NULL;
+  if (pthread_create(&player, NULL, play_thread, NULL))
+  { printf("Can't start the timeline player thread\n");
+    return -1;
+  }
+  player_running = 1;
+  return 0;
+} // start_player
+
+//
+// Play 'tl' after everything queued before it.
+// tl must stay valid until it has been played.
+//
+void queue_timeline(struct timeline *tl)
+{
+  pthread_mutex_lock(&lock);
+  tl->next = NULL;
+  if (queue_tail)
+    queue_tail->next = tl;
+  else
+    queue_head = tl;
+  queue_tail = tl;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+} // queue_timeline
+
+//
+// Wait until everything queued has been played
+// (never returns while a looping timeline plays)
+//
+void wait_player()
+{
+  pthread_mutex_lock(&lock);
+  while (queue_head || playing)
+    pthread_cond_wait(&cond, &lock);
+  pthread_mutex_unlock(&lock);
+} // wait_player
+
+void stop_player()
+{
+  if (!player_running)
+    return;
+  pthread_cancel(player);
+  pthread_join(player, NULL);
+  player_running = 0;
+} // stop_player
@@ -0,0 +1,53 @@
+//
+// Gertboard test suite
+//
+// GPIO waveform timeline header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// At time 't' (ns from the start of the timeline) clear the GPIOs in
+// 'clr' and then set the GPIOs in 'set'.
+struct tl_event {
+  unsigned long long t;
+  unsigned set;
+  unsigned clr;
+};
+
+struct timeline {
+  struct tl_event *ev;
+  int n, size;
+  unsigned long long length;  // time from start to start of next play
+  int loop;                   // play again until something else is queued
+  struct timeline *next;      // used by the player queue
+};
+
+void setup_timeline(struct timeline *tl);
+void free_timeline(struct timeline *tl);
+int  timeline_event(struct timeline *tl, unsigned long long t,
+                    unsigned set, unsigned clr);
+int  compile_timeline(struct timeline *tl, unsigned long long length,
+                      int loop);
+
+int  start_player(unsigned long spin);
+void queue_timeline(struct timeline *tl);
+void wait_player();
+void stop_player();
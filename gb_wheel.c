@@ -0,0 +1,389 @@
+//=============================================================================
+//
+//
+// Gertboard Common code
+//
+// This file is part of the gertboard test suite
+// Timing wheel: many timers, one dispatcher thread
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// The timeline player (gb_timeline.c) is right for a fixed pattern
+// known in advance. When a program has lots of independent things that
+// must happen at some time (switch a relay off in 2 seconds, the next
+// LED step, a DAC value), and which may be cancelled again before they
+// happen, we want to add and remove them cheaply while they wait.
+//
+// A sorted list costs O(n) per insert. A timing wheel costs O(1): time
+// is cut in ticks and a timer goes in the list of the slot of its tick.
+// One wheel of 256 slots only reaches 256 ticks ahead, so there are 4
+// levels with slots of 1, 256, 65536 and 16777216 ticks (up to 2^32
+// ticks ahead, with 100us ticks almost 5 days). Timers further away
+// sit in a coarse slot; when the time comes near, that slot is emptied
+// and its timers go one level down ("cascade"). Each timer moves at
+// most 3 times in its life, whatever the number of timers.
+//
+//   level 0 |0|1|2|...|255|  one tick per slot, fired from here
+//   level 1 |0|1|2|...|255|  256 ticks per slot
+//   level 2 |0|1|2|...|255|  65536 ticks per slot
+//   level 3 |0|1|2|...|255|  16777216 ticks per slot
+//
+// Every slot is a doubly linked list, so cancelling a timer is an
+// unlink. The timers themselves belong to the caller: nothing is
+// allocated, 10^6 pending timers cost 10^6 * sizeof(struct timer).
+//
+// One dispatcher thread runs the callbacks. It does not wake up every
+// tick: a bitmap of the level 0 slots tells it the next tick with work,
+// it sleeps until then (or the next cascade) like wait_until_ns() and
+// is woken early if a timer is added before that. Callbacks run
+// without the lock held, so they may add and cancel timers (also their
+// own: a periodic timer adds itself again). A timer fires at most one
+// tick (plus wake-up latency) after its time, never before.
+//
+// Compile with -pthread
+//
+
+#include "gb_common.h"
+#include "gb_wheel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#define WHEEL_BITS   8
+#define WHEEL_SLOTS  (1<<WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS-1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE  0xFFFFFFFFULL  // ticks, 2^(WHEEL_BITS*WHEEL_LEVELS)-1
+
+static struct timer slot[WHEEL_LEVELS][WHEEL_SLOTS]; // list heads
+static unsigned busy[WHEEL_SLOTS/32];  // level 0 slots with timers
+
+static unsigned long long base;        // ns, time of tick 0
+static unsigned long long cur;         // next tick to run
+static unsigned long long sleep_tick;  // dispatcher sleeps until this tick
+static unsigned long wheel_tick, wheel_spin;
+static long pending;
+static int in_tick;                    // run_tick() is calling back
+
+static pthread_t dispatcher;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cond;
+static int wheel_running, wheel_stop;
+static struct wheel_stats stats;
+
+void setup_timer(struct timer *tm, void (*fn)(void *arg), void *arg)
+{
+  memset(tm, 0, sizeof(*tm));
+  tm->where = -1;
+  tm->fn  = fn;
+  tm->arg = arg;
+} // setup_timer
+
+//
+// Put a timer in the slot for its tick
+//
+static void link_timer(struct timer *tm)
+{ unsigned long long e, d;
+  struct timer *h;
+  int lvl, s;
+
+  e = tm->tick < cur ? cur : tm->tick;  // too late: run it next
+  d = e - cur;
+  if (d > WHEEL_RANGE)
+  { // too far away: park it in the last slot, it cascades again
+    d = WHEEL_RANGE;
+    e = cur + d;
+  }
+  for (lvl = 0; lvl < WHEEL_LEVELS-1 && d >> (WHEEL_BITS*(lvl+1)); lvl++)
+    ;
+  s = (e >> (WHEEL_BITS*lvl)) & WHEEL_MASK;
+  h = &slot[lvl][s];
+  tm->next = h;
+  tm->prev = h->prev;
+  h->prev->next = tm;
+  h->prev = tm;
+  tm->where = lvl*WHEEL_SLOTS + s;
+  if (lvl == 0)
+    busy[s>>5] |= 1U << (s&31);
+} // link_timer
+
+static void unlink_timer(struct timer *tm)
+{ int s;
+  tm->prev->next = tm->next;
+  tm->next->prev = tm->prev;
+  s = tm->where;
+  if (s < WHEEL_SLOTS && slot[0][s].next == &slot[0][s])
+    busy[s>>5] &= ~(1U << (s&31));
+  tm->where = -1;
+} // unlink_timer
+
+//
+// Move all timers of a slot one (or more) levels down
+//
+static void cascade(int lvl, int s)
+{ struct timer *h, *tm, *next;
+
+  h = &slot[lvl][s];
+  if (h->next == h)
+    return;
+  // take the whole list first, a timer can end up in the same slot
+  tm = h->next;
+  h->prev->next = NULL;
+  h->next = h->prev = h;
+  for (; tm; tm = next)
+  { next = tm->next;
+    link_timer(tm);
+    stats.cascaded++;
+  }
+} // cascade
+
+//
+// Run tick 'cur': cascade when a level 0 round is complete, then
+// fire everything in its slot. Called and returns with the lock held.
+//
+static void run_tick()
+{ struct timer *h, *tm;
+  unsigned long long now;
+  long late;
+  int lvl, s;
+
+  if ((cur & WHEEL_MASK) == 0)
+    for (lvl = 1; lvl < WHEEL_LEVELS; lvl++)
+    { s = (cur >> (WHEEL_BITS*lvl)) & WHEEL_MASK;
+      cascade(lvl, s);
+      if (s)
+        break;
+    }
+
+  in_tick = 1;
+  h = &slot[0][cur & WHEEL_MASK];
+  while (h->next != h)
+  { tm = h->next;
+    unlink_timer(tm);
+    pending--;
+    pthread_mutex_unlock(&lock);
+    now = get_time_ns();
+    late = (long)(now - tm->t);
+    if (late > stats.late_max) stats.late_max = late;
+    stats.late_sum += late;
+    stats.fired++;
+    tm->fn(tm->arg);
+    pthread_mutex_lock(&lock);
+  }
+  in_tick = 0;
+  cur++;
+} // run_tick
+
+//
+// First tick from 'cur' on with timers in its level 0 slot,
+// or else the start of the next level 0 round (a cascade)
+//
+static unsigned long long next_tick()
+{ int s, w;
+  unsigned b;
+
+  s = cur & WHEEL_MASK;
+  for (w = s>>5; w < WHEEL_SLOTS/32; w++)
+  { b = busy[w];
+    if (w == s>>5)
+      b &= ~0U << (s&31);
+    if (b)
+      return (cur & ~(unsigned long long)WHEEL_MASK) + w*32 + __builtin_ctz(b);
+  }
+  // (if 'cur' starts a round its cascade is still to be done)
+  return (cur + WHEEL_MASK) & ~(unsigned long long)WHEEL_MASK;
+} // next_tick
+
+static void *wheel_thread(void *arg)
+{ unsigned long long t, wake;
+  struct timespec ts;
+
+  pthread_mutex_lock(&lock);
+  // stop_wheel() does not cancel us, we could be in a callback
+  while (!wheel_stop)
+  { // catch up with every tick that is due
+    while (base + cur * wheel_tick <= get_time_ns())
+      run_tick();
+
+    if (pending == 0)
+    { sleep_tick = ~0ULL;
+      pthread_cond_wait(&cond, &lock);
+      continue;
+    }
+    sleep_tick = next_tick();
+    t = base + sleep_tick * wheel_tick;
+    wake = t > wheel_spin ? t - wheel_spin : 0;
+    if (get_time_ns() < wake)
+    { // sleep, but add_timer() can wake us for an earlier timer
+      ts.tv_sec  = wake / 1000000000ULL;
+      ts.tv_nsec = wake % 1000000000ULL;
+      pthread_cond_timedwait(&cond, &lock, &ts);
+      stats.wakeups++;
+      continue;
+    }
+    // the last bit: spin without the lock
+    pthread_mutex_unlock(&lock);
+    while (get_time_ns() < t)
+      ;
+    pthread_mutex_lock(&lock);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+} // wheel_thread
+
+//
+// Start the dispatcher. Timer times are rounded up to 'tick' ns.
+// 'spin' as for wait_until_ns, keep it shorter than a tick.
+// Returns 0 on success
+//
+int start_wheel(unsigned long tick, unsigned long spin)
+{ pthread_condattr_t attr;
+  int l, s;
+
+  if (wheel_running || tick == 0)
+    return -1;
+  for (l = 0; l < WHEEL_LEVELS; l++)
+    for (s = 0; s < WHEEL_SLOTS; s++)
+      slot[l][s].next = slot[l][s].prev = &slot[l][s];
+  memset(busy, 0, sizeof(busy));
+  memset(&stats, 0, sizeof(stats));
+  wheel_tick = tick;
+  wheel_spin = spin;
+  base = get_time_ns();
+  cur = 0;
+  pending = 0;
+  wheel_stop = 0;
+
+  // the deadlines are get_time_ns() times
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&dispatcher, NULL, wheel_thread, NULL))
+  { printf("Can't start the timer thread\n");
+    pthread_cond_destroy(&cond);
+    return -1;
+  }
+  wheel_running = 1;
+  return 0;
+} // start_wheel
+
+//
+// Fire 'tm' at time 't' (get_time_ns). A pending timer is moved.
+// Returns 0 on success, -1 if the wheel is not running
+//
+int add_timer(struct timer *tm, unsigned long long t)
+{ unsigned long long now;
+
+  if (!wheel_running)
+    return -1;
+  pthread_mutex_lock(&lock);
+  if (tm->where >= 0)
+  { unlink_timer(tm);
+    pending--;
+  }
+  if (pending == 0 && !in_tick)
+  { // nothing in the wheel: skip the idle ticks in one go
+    now = (get_time_ns() - base) / wheel_tick;
+    if (now > cur)
+      cur = now;
+  }
+  tm->t = t;
+  tm->tick = t > base ? (t - base + wheel_tick - 1) / wheel_tick : 0;
+  link_timer(tm);
+  pending++;
+  if (tm->tick < sleep_tick)
+    pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&lock);
+  return 0;
+} // add_timer
+
+//
+// Take a timer out before it fires
+// Returns 1 if it was pending, 0 if it was not (or already fired)
+//
+int cancel_timer(struct timer *tm)
+{
+  if (!wheel_running)
+    return 0;
+  pthread_mutex_lock(&lock);
+  if (tm->where < 0)
+  { pthread_mutex_unlock(&lock);
+    return 0;
+  }
+  unlink_timer(tm);
+  pending--;
+  stats.cancelled++;
+  pthread_mutex_unlock(&lock);
+  return 1;
+} // cancel_timer
+
+int timer_pending(struct timer *tm)
+{
+  return tm->where >= 0;
+} // timer_pending
+
+//
+// Stop the dispatcher, timers that did not fire yet are dropped
+//
+void stop_wheel(struct wheel_stats *st)
+{ struct timer *h;
+  int l, s;
+
+  if (wheel_running)
+  { pthread_mutex_lock(&lock);
+    wheel_stop = 1;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(dispatcher, NULL);
+    pthread_cond_destroy(&cond);
+    wheel_running = 0;
+    // leave the timers idle so they can be added again
+    for (l = 0; l < WHEEL_LEVELS; l++)
+      for (s = 0; s < WHEEL_SLOTS; s++)
+      { h = &slot[l][s];
+        while (h->next != h)
+          unlink_timer(h->next);
+      }
+  }
+  if (st)
+    *st = stats;
+} // stop_wheel
+
+static void gpio_action(void *arg)
+{ struct gpio_timer *gt = arg;
+  GPIO_CLR0 = gt->clr;
+  GPIO_SET0 = gt->set;
+} // gpio_action
+
+//
+// A timer which clears and sets GPIOs, like a timeline event:
+//   setup_gpio_timer(&off, 0, 1<<4);
+//   add_timer(&off.tm, get_time_ns() + 2000000000ULL);
+//
+void setup_gpio_timer(struct gpio_timer *gt, unsigned set, unsigned clr)
+{
+  setup_timer(&gt->tm, gpio_action, gt);
+  gt->set = set;
+  gt->clr = clr;
+} // setup_gpio_timer
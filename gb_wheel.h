@@ -0,0 +1,62 @@
+//
+// Gertboard test suite
+//
+// timing wheel header file
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+// (e.g. do not use #ifndef big_demo_h....)
+//
+
+// A timer is owned by the caller (embed it in your own struct), the
+// wheel only links it in. Set it up once with setup_timer(), after that
+// it can be added and cancelled as often as you like.
+struct timer {
+  struct timer *next, *prev;  // slot list, only touched by gb_wheel.c
+  unsigned long long t;       // ns, absolute (get_time_ns) fire time
+  unsigned long long tick;    // wheel tick it fires in
+  int where;                  // wheel slot (level*256 + slot), -1: idle
+  void (*fn)(void *arg);      // called from the dispatcher thread
+  void *arg;
+};
+
+// Clear the GPIOs in 'clr' and then set the GPIOs in 'set' at time 't'
+struct gpio_timer {
+  struct timer tm;
+  unsigned set;
+  unsigned clr;
+};
+
+struct wheel_stats {
+  unsigned long long fired;      // callbacks run
+  unsigned long long cancelled;  // pending timers cancelled
+  unsigned long long cascaded;   // timers moved down a level
+  unsigned long long wakeups;    // times the dispatcher woke up
+  long late_max;                 // ns, callback start after fire time
+  double late_sum;               // ns, for the average
+};
+
+void setup_timer(struct timer *tm, void (*fn)(void *arg), void *arg);
+int  start_wheel(unsigned long tick, unsigned long spin);
+int  add_timer(struct timer *tm, unsigned long long t);
+int  cancel_timer(struct timer *tm);
+int  timer_pending(struct timer *tm);
+void stop_wheel(struct wheel_stats *st);
+
+void setup_gpio_timer(struct gpio_timer *gt, unsigned set, unsigned clr);
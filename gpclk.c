@@ -0,0 +1,117 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Reference clock output on GPIO4
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Put a general purpose clock on a pin, e.g. as the clock of an
+// external ADC. Once started the clock manager does all the work,
+// the program only waits for you to hit enter and stops it again.
+//
+//   sudo ./gpclk -f 1000000          (1 MHz on GP4)
+//   sudo ./gpclk -f 32768 -m 1       (fractional divider, jitters)
+//
+
+#include "gb_common.h"
+#include "gb_clk.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// gpclk GPIO mapping:
+//         Function            Mode
+// GPIO4=  GPCLK0              Alt0  (default)
+// GPIO5=  GPCLK1              Alt0  (-g 1, not on the Gertboard)
+// GPIO6=  GPCLK2              Alt0  (-g 2, not on the Gertboard)
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s -f hz [-g 0|1|2] [-s osc|plld|auto] [-m mash]\n"
+    "  -m 0 integer divider only, 1-3 fractional (MASH order),\n"
+    "     default: integer if within 0.1%%, otherwise MASH 1\n",
+    prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, gp, src, mash, pin;
+  double hz, f;
+
+  hz   = 0;
+  gp   = CLK_GP0;
+  src  = CLK_SRC_AUTO;
+  mash = -1;
+
+  while ((c = getopt(argc, argv, "f:g:s:m:")) != -1)
+  {
+    switch (c)
+    {
+    case 'f' : hz   = atof(optarg); break;
+    case 'g' : gp   = atoi(optarg); break;
+    case 'm' : mash = atoi(optarg); break;
+    case 's' :
+      if (!strcmp(optarg, "osc"))       src = CLK_SRC_OSC;
+      else if (!strcmp(optarg, "plld")) src = CLK_SRC_PLLD;
+      else if (!strcmp(optarg, "auto")) src = CLK_SRC_AUTO;
+      else usage(argv[0]);
+      break;
+    default: usage(argv[0]);
+    }
+  }
+  if (hz <= 0 || gp < CLK_GP0 || gp > CLK_GP2 || mash < -1 || mash > 3)
+    usage(argv[0]);
+  pin = 4 + gp;
+
+  printf ("These are the connections for the clock output:\n");
+  printf ("GP%d --- clock input of your circuit, scope or frequency meter\n",
+          pin);
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  if ((f = setup_clock(gp, src, hz, mash)) == 0)
+  { printf("Can't make %.0f Hz\n", hz);
+    restore_io();
+    return EXIT_FAILURE;
+  }
+  INP_GPIO(pin);  SET_GPIO_ALT(pin, 0);
+
+  printf("GPCLK%d running at %.3f Hz (%+.3f Hz from what you asked)\n",
+         gp, f, f - hz);
+  printf("Hit enter to stop.\n");
+  (void) getchar();
+
+  INP_GPIO(pin);
+  stop_clock(gp);
+  restore_io();
+  return 0;
+} // main
@@ -0,0 +1,241 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Loop jitter and wake-up latency measurement
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// This program toggles a GPIO pin at a fixed period and records how late
+// every single cycle was woken up compared to its deadline. At the end it
+// prints a histogram and the min/average/max lateness so you know what
+// period and jitter you can expect from your kernel and CPU settings.
+//
+// Three wait strategies can be compared:
+//   busy   : spin on the clock all the time (lowest jitter, 100% CPU)
+//   sleep  : let the kernel wake us up at the deadline (clock_nanosleep)
+//   hybrid : sleep until a little before the deadline, then spin
+//
+// Optionally the output can be looped back into a second GPIO pin. The
+// program then also measures how long it takes before the new level is
+// seen in GPIO_IN0.
+//
+// To see what a real-time profile buys you, run with and without -P:
+//   sudo ./jitter -m sleep -P 80 -a 0 -L -D
+//
+
+#include "gb_common.h"
+#include "gb_rt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// jitter test GPIO mapping:
+//         Function            Mode
+// GPIO25= toggled output      Output  (can be changed with -o)
+// GPIO24= loopback input      Input   (only with -l)
+
+enum { MODE_BUSY, MODE_SLEEP, MODE_HYBRID };
+
+static int out_pin = 25;
+static int in_pin  = -1;
+
+void setup_gpio()
+{
+  INP_GPIO(out_pin);  OUT_GPIO(out_pin);
+  if (in_pin >= 0)
+    INP_GPIO(in_pin);
+} // setup_gpio
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-p period_us] [-n cycles] [-m busy|sleep|hybrid]\n"
+    "          [-s spin_us] [-r resolution_ns] [-o out_gpio] [-l in_gpio]\n"
+    "          [-f dump_file] [-P rt_prio] [-a cpu] [-L] [-D]\n"
+    "  -L lock and prefault memory, -D keep CPU out of deep C-states\n",
+    prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, mode, level, rt, prio, cpu;
+  long n, i, period, spin, res, late, loop, loop_n, loop_missed;
+  long late_min, late_max, loop_min, loop_max;
+  double late_sum, loop_sum;
+  unsigned long long deadline, now, t0;
+  unsigned late_hist[HIST_BUCKETS], loop_hist[HIST_BUCKETS];
+  long *late_log;
+  char *dump = NULL;
+  FILE *fp;
+
+  period = 1000;   // us
+  n      = 10000;
+  spin   = 50;     // us, hybrid only
+  res    = 1000;   // ns per histogram bucket
+  mode   = MODE_HYBRID;
+  rt     = 0;
+  prio   = 0;
+  cpu    = 0;
+
+  while ((c = getopt(argc, argv, "p:n:m:s:r:o:l:f:P:a:LD")) != -1)
+  {
+    switch (c)
+    {
+    case 'p' : period = atol(optarg); break;
+    case 'n' : n      = atol(optarg); break;
+    case 's' : spin   = atol(optarg); break;
+    case 'r' : res    = atol(optarg); break;
+    case 'o' : out_pin = atoi(optarg); break;
+    case 'l' : in_pin  = atoi(optarg); break;
+    case 'f' : dump    = optarg; break;
+    case 'P' : prio = atoi(optarg); rt |= RT_PRIORITY; break;
+    case 'a' : cpu  = atoi(optarg); rt |= RT_AFFINITY; break;
+    case 'L' : rt |= RT_LOCK_MEM|RT_PREFAULT; break;
+    case 'D' : rt |= RT_NO_CSTATE; break;
+    case 'm' :
+      if (!strcmp(optarg, "busy"))        mode = MODE_BUSY;
+      else if (!strcmp(optarg, "sleep"))  mode = MODE_SLEEP;
+      else if (!strcmp(optarg, "hybrid")) mode = MODE_HYBRID;
+      else usage(argv[0]);
+      break;
+    default: usage(argv[0]);
+    }
+  }
+  if (period <= 0 || n <= 0 || res <= 0 || out_pin < 0 || out_pin > 31
+      || in_pin > 31 || in_pin == out_pin)
+    usage(argv[0]);
+
+  period *= 1000; // everything below is in ns
+  if (mode == MODE_BUSY)  spin = period;
+  if (mode == MODE_SLEEP) spin = 0;
+  if (mode == MODE_HYBRID) spin *= 1000;
+
+  if ((late_log = malloc(n * sizeof(long))) == NULL)
+  { printf("allocation error \n");
+    exit(-1);
+  }
+
+  printf ("These are the connections for the jitter test:\n");
+  printf ("(optional) GP%d in J2 --- scope or logic analyser\n", out_pin);
+  if (in_pin >= 0)
+    printf ("GP%d in J2 --- GP%d in J2 (loopback)\n", out_pin, in_pin);
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  setup_gpio();
+
+  if (rt)
+  { if (setup_rt(rt, prio, cpu))
+      printf("Warning: not all of the real-time profile could be applied\n");
+    if (rt & RT_PREFAULT)
+      prefault(late_log, n * sizeof(long));
+  }
+
+  memset(late_hist, 0, sizeof(late_hist));
+  memset(loop_hist, 0, sizeof(loop_hist));
+  late_min = loop_min = 0x7FFFFFFF;
+  late_max = loop_max = 0;
+  late_sum = loop_sum = 0;
+  loop_n = loop_missed = 0;
+  level = 0;
+  GPIO_CLR0 = 1<<out_pin;
+
+  // first deadline one period from now, after that always add the
+  // period to the previous deadline so errors do not accumulate
+  deadline = get_time_ns() + period;
+  t0 = deadline;
+  for (i = 0; i < n; i++)
+  {
+    wait_until_ns(deadline, spin);
+    now = get_time_ns();
+
+    level = !level;
+    if (level)
+      GPIO_SET0 = 1<<out_pin;
+    else
+      GPIO_CLR0 = 1<<out_pin;
+
+    late = (long)(now - deadline);
+    late_log[i] = late;
+    late_sum += late;
+    if (late < late_min) late_min = late;
+    if (late > late_max) late_max = late;
+    hist_add(late_hist, late, res);
+
+    if (in_pin >= 0)
+    { // wait (max. 1/2 period) until the level arrives at the input
+      while ((int)((GPIO_IN0 >> in_pin) & 1) != level &&
+             get_time_ns() - now < (unsigned long long)period/2)
+        ;
+      loop = (long)(get_time_ns() - now);
+      if ((int)((GPIO_IN0 >> in_pin) & 1) != level)
+        loop_missed++; // never arrived: a missing wire is not a latency
+      else
+      { loop_n++;
+        loop_sum += loop;
+        if (loop < loop_min) loop_min = loop;
+        if (loop > loop_max) loop_max = loop;
+        hist_add(loop_hist, loop, res);
+      }
+    }
+
+    deadline += period;
+  } // cycle loop
+
+  GPIO_CLR0 = 1<<out_pin;
+  if (rt)
+    restore_rt();
+  restore_io();
+
+  printf("%ld cycles of %ld us, achieved %.1f us per cycle\n", n, period/1000,
+         (double)(get_time_ns() - t0) / n / 1000);
+  hist_print("wake-up lateness", late_hist, res, late_min, late_max,
+             late_sum, n);
+  if (in_pin >= 0 && loop_n)
+    hist_print("output to input loopback", loop_hist, res,
+               loop_min, loop_max, loop_sum, loop_n);
+  if (loop_missed)
+    printf("Warning: the level did not arrive at GPIO%d in %ld of %ld cycles"
+           " (check the wire)\n", in_pin, loop_missed, n);
+
+  if (dump)
+  { if ((fp = fopen(dump, "w")) == NULL)
+      printf("Can't open %s\n", dump);
+    else
+    { for (i = 0; i < n; i++)
+        fprintf(fp, "%ld\n", late_log[i]);
+      fclose(fp);
+    }
+  }
+  free(late_log);
+
+  return 0;
+} // main
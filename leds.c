@@ -30,6 +30,9 @@
 //
 
 #include "gb_common.h"
+#include "gb_timeline.h"
+#include "gb_pins.h"
+#include "gb_opts.h"
 
 // Use defines for the LEDS. In the GPIO code, GPIO pins n is controlled
 // by bit n. The idea is here is that for example L1 will refer
@@ -37,21 +40,26 @@
 // put a strap between GP25 anb B1). This gives a more intuitive 
 // name to use for the LEDs in the patterns.
 //
+// LED_MAP is the pin group (see gb_pins.h) of the 12 LEDs: bit 0 of a
+// value is L1 on GPIO25, bit 11 is L12 on GPIO7.
+//
 // For novice users: don't worry about the complexity
 // The compiler will optimise out all constant expressions and you
 // will end up with a single constant value in your table.
-#define L1 (1<<25)
-#define L2 (1<<24)
-#define L3 (1<<23)
-#define L4 (1<<22)
-#define L5 (1<<21)
-#define L6 (1<<18)
-#define L7 (1<<17)
-#define L8 (1<<11)
-#define L9 (1<<10)
-#define L10 (1<<9)
-#define L11 (1<<8)
-#define L12 (1<<7)
+#define LED_MAP(v) (PIN_MAP8((v),      25, 24, 23, 22, 21, 18, 17, 11) | \
+                    PIN_MAP8((v) >> 8, 10,  9,  8,  7, -1, -1, -1, -1))
+#define L1  LED_MAP(1<<0)
+#define L2  LED_MAP(1<<1)
+#define L3  LED_MAP(1<<2)
+#define L4  LED_MAP(1<<3)
+#define L5  LED_MAP(1<<4)
+#define L6  LED_MAP(1<<5)
+#define L7  LED_MAP(1<<6)
+#define L8  LED_MAP(1<<7)
+#define L9  LED_MAP(1<<8)
+#define L10 LED_MAP(1<<9)
+#define L11 LED_MAP(1<<10)
+#define L12 LED_MAP(1<<11)
 
 #define ALL_LEDS  (L1|L2|L3|L4|L5|L6|L7|L8|L9|L10|L11|L12)
 
@@ -136,19 +144,10 @@ static int pattern2[] =
    L12,
    -1};
 
-// Local (to this file) variables
-static int *pattern = pattern0;  // current pattern
-static int step = 0;  // which pattern element we are showing
+static int *patterns[] = { pattern0, pattern1, pattern2 };
 
-void show_LEDs(int value)
-{
-  // first turn off all LEDs - GPIO_CLR0 selects which output pins
-  // will be set up 0
-  GPIO_CLR0 = ALL_LEDS;
-  // now light up the ones for this value - GPIO_SET0 selects which 
-  // output pins will be set up 1
-  GPIO_SET0 = value;
-} // set_pattern
+// How long every step of a pattern is shown
+#define STEP_NS 100000000ULL // 0.1 second
 
 void leds_off(void)
 {
@@ -156,60 +155,61 @@ void leds_off(void)
 }
 
 //
-// Start anew with one of the available patterns
+// Turn a pattern into a timeline for the player (see gb_timeline.c)
+// Every step turns off all LEDs and lights up the ones for this step
+// (the player does the clear before the set). We go through the
+// pattern 'repeat' times.
 //
-void start_new_pattern(int p)
-{
-   switch (p)
-   {
-   case 0 : pattern = pattern0; break;
-   case 1 : pattern = pattern1; break;
-   case 2 : pattern = pattern2; break;
-   default: return;
-   }
-   step = 0;
-   // show the LEDs for the first item in the new pattern
-   show_LEDs(pattern[step]);
-} // start_new_pattern
-
-//
-// Do single pattern step
-// return 1 on last pattern
-// return 0 on all others
-//
-int led_step()
-{
-   step++;
-   if (pattern[step]==-1) // we're at end of this pattern, start over
-      step=0;
-   show_LEDs(pattern[step]);
-   return pattern[step+1]== -1 ? 1 : 0; // are we at last value?
-} // led_step
+int make_pattern_timeline(struct timeline *tl, int *pattern, int repeat)
+{ unsigned long long t;
+  int r, step;
+
+  setup_timeline(tl);
+  t = 0;
+  for (r = 0; r < repeat; r++)
+    for (step = 0; pattern[step] != -1; step++)
+    { if (timeline_event(tl, t, pattern[step], ALL_LEDS))
+        return -1;
+      t += STEP_NS;
+    }
+  compile_timeline(tl, t, 0);
+  return 0;
+} // make_pattern_timeline
 
 //
 // Quick play all patterns
+// One iteration plays one pattern (twice), the next one the next
+// pattern. The iteration time in the summary shows how exactly the
+// player keeps the step time.
 //
-int main(void)
-{ int p,r,last;
-
-  printf ("These are the connections for the LEDs test:\n");
-  printf ("jumpers in every out location (U3-out-B1, U3-out-B2, etc)\n");
-  printf ("GP25 in J2 --- B1 in J3\n");
-  printf ("GP24 in J2 --- B2 in J3\n");
-  printf ("GP23 in J2 --- B3 in J3\n");
-  printf ("GP22 in J2 --- B4 in J3\n");
-  printf ("GP21 in J2 --- B5 in J3\n");
-  printf ("GP18 in J2 --- B6 in J3\n");
-  printf ("GP17 in J2 --- B7 in J3\n");
-  printf ("GP11 in J2 --- B8 in J3\n");
-  printf ("GP10 in J2 --- B9 in J3\n");
-  printf ("GP9 in J2 --- B10 in J3\n");
-  printf ("GP8 in J2 --- B11 in J3\n");
-  printf ("GP7 in J2 --- B12 in J3\n");
-  printf ("(If you don't have enough straps and jumpers you can install\n");
-  printf ("just a few of them, then run again later with the next batch.)\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+int main(int argc, char **argv)
+{ int p, n;
+  struct timeline tl[3];
+  struct gb_opts o;
+
+  setup_opts(&o, argc, argv, 3, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the LEDs test:\n");
+    printf ("jumpers in every out location (U3-out-B1, U3-out-B2, etc)\n");
+    printf ("GP25 in J2 --- B1 in J3\n");
+    printf ("GP24 in J2 --- B2 in J3\n");
+    printf ("GP23 in J2 --- B3 in J3\n");
+    printf ("GP22 in J2 --- B4 in J3\n");
+    printf ("GP21 in J2 --- B5 in J3\n");
+    printf ("GP18 in J2 --- B6 in J3\n");
+    printf ("GP17 in J2 --- B7 in J3\n");
+    printf ("GP11 in J2 --- B8 in J3\n");
+    printf ("GP10 in J2 --- B9 in J3\n");
+    printf ("GP9 in J2 --- B10 in J3\n");
+    printf ("GP8 in J2 --- B11 in J3\n");
+    printf ("GP7 in J2 --- B12 in J3\n");
+    printf ("(If you don't have enough straps and jumpers you can install\n");
+    printf ("just a few of them, then run again later with the next batch.)\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
@@ -224,21 +224,35 @@ int main(void)
   (void) getchar();
   */
 
-  for (p=0; p<3; p++)
-  {
-    // run pattern several times
-    start_new_pattern(p);
-    for (r=0; r<2; r++)
-    { do {
-        last = led_step();
-        long_wait(3);
-      } while (!last);
-    } // run the pattern 2 times
+  for (n=0; n<3; n++)
+  { // run pattern several times
+    if (make_pattern_timeline(&tl[n], patterns[n], 2))
+    { printf("allocation error \n");
+      while (n >= 0)
+        free_timeline(&tl[n--]);
+      restore_io();
+      return 1;
+    }
+  }
+
+  // The player thread shows every step of the patterns at exactly the
+  // right time, while this thread has nothing to do but wait.
+  if (start_player(50000))
+  { restore_io();
+    return 1;
+  }
+  p = 0;
+  while (next_iteration(&o))
+  { queue_timeline(&tl[p]);
+    wait_player();
+    p = (p + 1) % 3;
   } // loop over patterns
+  stop_player();
+  for (n=0; n<3; n++)
+    free_timeline(&tl[n]);
 
   leds_off();
+  print_summary(&o);
   restore_io();
+  return 0;
 } // main
-
-
-
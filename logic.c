@@ -0,0 +1,147 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Logic analyser
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Capture the activity on the buffered I/O pins and save it to a file.
+// Only changes are stored (see gb_capture.c) so you can capture for a
+// long time without filling the disk. Convert the capture to VCD to
+// look at it in a waveform viewer such as GTKWave:
+//
+//   sudo ./logic -r 1000000 -t 10 -o spi.cap -v spi.vcd
+//   ./logic -x spi.cap -v spi.vcd     (convert only, no hardware needed)
+//
+
+#include "gb_common.h"
+#include "gb_rt.h"
+#include "gb_capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// The pins which come out on J2 of the Gertboard
+#define GB_PINS ((1<<0)|(1<<1)|(1<<4)|(1<<7)|(1<<8)|(1<<9)|(1<<10)|(1<<11)| \
+                 (1<<14)|(1<<15)|(1<<17)|(1<<18)|(1<<21)|(1<<22)|(1<<23)|  \
+                 (1<<24)|(1<<25))
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-r rate_hz] [-t seconds] [-m hex_mask] [-o capture_file]\n"
+    "          [-v vcd_file] [-P rt_prio]\n"
+    "       %s -x capture_file -v vcd_file\n", prog, prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, prio;
+  long rate;
+  double secs;
+  unsigned mask;
+  char *capfile, *vcdfile, *convert;
+  struct capture_stats st;
+  struct timespec ts;
+
+  rate    = 100000;
+  secs    = 5;
+  mask    = GB_PINS;
+  prio    = 0;
+  capfile = "capture.cap";
+  vcdfile = NULL;
+  convert = NULL;
+
+  while ((c = getopt(argc, argv, "r:t:m:o:v:x:P:")) != -1)
+  {
+    switch (c)
+    {
+    case 'r' : rate    = atol(optarg); break;
+    case 't' : secs    = atof(optarg); break;
+    case 'm' : mask    = strtoul(optarg, NULL, 16); break;
+    case 'o' : capfile = optarg; break;
+    case 'v' : vcdfile = optarg; break;
+    case 'x' : convert = optarg; break;
+    case 'P' : prio    = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+
+  if (convert)
+  { if (!vcdfile)
+      usage(argv[0]);
+    return capture_to_vcd(convert, vcdfile) ? EXIT_FAILURE : 0;
+  }
+  if (rate <= 0 || rate > 1000000000 || secs <= 0)
+    usage(argv[0]);
+
+  printf ("Connect the signals you want to look at to the GPx pins in J2\n");
+  printf ("(jumper the buffers as inputs if the signals are 5V!)\n");
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  // We only read GPIO_IN0, no need to change any pin modes
+
+  // Only the sampler runs at 'prio'. It spins and never sleeps, so we
+  // (and the writer thread, which inherits from us) run one level above
+  // it, else on a single core nobody would ever stop the capture.
+  if (prio)
+  { if (prio > 98)
+      prio = 98;
+    setup_rt(RT_DEFAULT, prio+1, 0);
+  }
+
+  if (start_capture(capfile, mask, 1000000000 / rate, prio))
+  { restore_io();
+    return EXIT_FAILURE;
+  }
+  ts.tv_sec  = (time_t)secs;
+  ts.tv_nsec = (long)((secs - ts.tv_sec) * 1e9);
+  nanosleep(&ts, NULL);
+  stop_capture(&st);
+
+  if (prio)
+    restore_rt();
+  restore_io();
+
+  printf("%llu samples in %.3f s (%.0f Hz), %llu changes stored\n",
+         st.samples, st.ns/1e9, st.samples/(st.ns/1e9), st.records);
+  if (st.missed)
+    printf("Warning: %llu sample slots missed\n", st.missed);
+  if (st.dropped)
+    printf("Warning: changes stored late, %llu samples (disk too slow)\n",
+           st.dropped);
+
+  if (vcdfile && capture_to_vcd(capfile, vcdfile))
+    return EXIT_FAILURE;
+  return 0;
+} // main
@@ -30,6 +30,9 @@
 
 #include "gb_common.h"
 #include "gb_pwm.h"
+#include "gb_rt.h"
+#include "gb_motion.h"
+#include "gb_opts.h"
 
 // motor test GPIO mapping:
 //         Function            Mode
@@ -58,22 +61,34 @@ void setup_gpio(void)
 } // setup_gpio
 
 
-void main()
-{ int r,s;
+#define TICK 5000000 // ns between speed updates
 
-  printf ("These are the connections for the motor test:\n");
-  printf ("GP17 in J2 --- MOTB (just above GP1)\n");
-  printf ("GP18 in J2 --- MOTA (just above GP4)\n");
-  printf ("+ of external power source --- MOT+ in J19\n");
-  printf ("ground of external power source --- GND (any)\n");
-  printf ("one wire for your motor in MOTA in J19\n");
-  printf ("the other wire for your motor in MOTB in J19\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+void main(int argc, char **argv)
+{ struct profile up, rev, stop;
+  struct gb_opts o;
+
+  // an iteration is one forwards/backwards/stop cycle
+  setup_opts(&o, argc, argv, 1, 1, 0);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the motor test:\n");
+    printf ("GP17 in J2 --- MOTB (just above GP1)\n");
+    printf ("GP18 in J2 --- MOTA (just above GP4)\n");
+    printf ("+ of external power source --- MOT+ in J19\n");
+    printf ("ground of external power source --- GND (any)\n");
+    printf ("one wire for your motor in MOTA in J19\n");
+    printf ("the other wire for your motor in MOTB in J19\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
 
+  // Optional real-time profile, see gb_rt.c
+  setup_rt_env();
+
   // Set GPIO pin 18 to use PWM and pin 17 to output mode
   setup_gpio();
 
@@ -81,50 +96,42 @@ void main()
   GPIO_CLR0 = 1<<17; // Set GPIO pin LOW
   setup_pwm(17);
 
-  printf("\n>>> "); fflush(stdout);
-  // motor B input is still low, so motor gets power when pwm input A is high
-  force_pwm0(0,PWM0_ENABLE);
-  // start motor off slow (low most of the time) then ramp up speed
-  // (increasing the high part of the pulses)
-  for (s=0x100; s<=0x400; s+=0x10)
-    { long_wait(6);
-      set_pwm0(s);
-      putchar('+'); fflush(stdout);
-    }
-  long_wait(10);
-  // now slow the motor down by decreasing the time the pwm is high
-  for (s=0x400; s>=0x100; s-=0x10)
-    { long_wait(6);
-      set_pwm0(s);
-      putchar('-'); fflush(stdout);
-    }
-  // make sure motor is stopped
-  pwm_off();
-  // same in reverse direction
-  // set motor B input to high, so motor gets power when pwm input A is low
-  GPIO_SET0 = 1<<17;
-  // when we enable pwm with reverse polarity, a pwm value near 0 means
-  // that the LOW phase is only done for a short period amount of time
-  // and a pwm value near 0x400 (the max we set in setup_pwm) means
-  // that the LOW phase is done for a long period amount of time
-  force_pwm0(0,PWM0_ENABLE|PWM0_REVPOLAR);
-  printf("\n<<< ");
-  // as before we ramp up speed of motor
-  for (s=0x100; s<=0x400; s+=0x10)
-    { long_wait(6);
-      set_pwm0(s);
-      putchar('+'); fflush(stdout);
-    }
-  long_wait(10);
-  // then slow it down
-  for (s=0x400; s>=0x100; s-=0x10)
-    { long_wait(6);
-      set_pwm0(s);
-      putchar('-'); fflush(stdout);
-    }
-  GPIO_CLR0 = 1<<17;
-  pwm_off();
+  // The ramps are worked out beforehand and played by the motion thread
+  // (see gb_motion.c) on a 5ms clock, so they take the same time on
+  // every Pi. Speeds are PWM values, negative means the other direction:
+  // there the motor B input is high and we use PWM0_REVPOLAR so that a
+  // high value still means fast. The motion thread does that switch
+  // for us when the speed goes through 0.
+  // Speed up to full speed forwards in 2.5s (S-curve), hold for 1s,
+  // go to full speed backwards, hold again and stop.
+  if (plan_profile(&up,   0,     0x400,  512, 1024, 1.0, TICK) ||
+      plan_profile(&rev,  0x400, -0x400, 512, 1024, 1.0, TICK) ||
+      plan_profile(&stop, -0x400, 0,     512, 1024, 0.0, TICK) ||
+      start_motion(17, TICK, 0))
+  { pwm_off();
+    restore_rt();
+    restore_io();
+    return;
+  }
+  while (next_iteration(&o))
+  {
+    printf("\n>>> forwards\n");
+    queue_profile(&up);
+    queue_profile(&rev);
+    queue_profile(&stop);
+    // the main program is free to do other things now
+    while (motion_speed() >= 0)
+      wait_until_ns(get_time_ns() + 10000000, 0);
+    printf("<<< backwards\n");
+    wait_motion();
+  } // while
+  stop_motion();
+  free_profile(&up);
+  free_profile(&rev);
+  free_profile(&stop);
   putchar('\n');
 
+  restore_rt();
+  print_summary(&o);
   restore_io();
 }
@@ -0,0 +1,348 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Several board demos at the same time
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// The LED walk, the buttons, the ADC and the motor all at the same time,
+// in one thread which sleeps whenever no task can go on (see gb_task.c):
+// - the LEDs walk one step every 100ms
+// - B1 switches the motor on and off, B2 reverses the LEDs; the button
+//   task sleeps on the kernel edge events and debounces by itself
+// - the pot is read every 10ms, every second min/avg/max are printed
+// - while on, the motor follows the pot like in potmot
+// - type q and enter to stop
+// At the end we show how often each task ran and how little CPU it took.
+// What is left of polling: an ADC conversion is checked every 20us
+// until it is done (the SPI interrupt is not ours), and start_adc()
+// holds chip select high for well under a microsecond in short_wait().
+//
+
+#include "gb_common.h"
+#include "gb_spi.h"
+#include "gb_pwm.h"
+#include "gb_edge.h"
+#include "gb_loop.h"
+#include "gb_potctl.h"
+#include "gb_task.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// multitask GPIO mapping:
+//         Function            Mode
+// GPIO4=  LED (B6)            Output
+// GPIO8=  SPI chip select A   Alt. 0
+// GPIO9=  SPI MISO            Alt. 0
+// GPIO10= SPI MOSI            Alt. 0
+// GPIO11= SPI CLK             Alt. 0
+// GPIO17= motor control B     Output
+// GPIO18= PWM (motor A)       alt ftn 5
+// GPIO21= LED (B5)            Output
+// GPIO22= LED (B4)            Output
+// GPIO23= LED (B3)            Output
+// GPIO24= Pushbutton (B2)     Input
+// GPIO25= Pushbutton (B1)     Input
+
+#define N_LEDS      4
+#define LED_STEP    100000000  // ns
+#define ADC_PERIOD  10000000   // ns
+#define MOTOR_STEP  20000000   // ns
+#define SPI_POLL    20000      // ns, a transfer takes 16us
+#define BAND        8          // hysteresis around the middle of the pot
+
+static const int led_pin[N_LEDS] = {23, 22, 21, 4};
+static unsigned led_mask;
+
+void setup_gpio()
+{ int i;
+  for (i = 0; i < N_LEDS; i++)
+  { INP_GPIO(led_pin[i]);  OUT_GPIO(led_pin[i]);
+    led_mask |= 1 << led_pin[i];
+  }
+  INP_GPIO(8);  SET_GPIO_ALT(8,0);
+  INP_GPIO(9);  SET_GPIO_ALT(9,0);
+  INP_GPIO(10); SET_GPIO_ALT(10,0);
+  INP_GPIO(11); SET_GPIO_ALT(11,0);
+  INP_GPIO(17); OUT_GPIO(17);
+  INP_GPIO(18); SET_GPIO_ALT(18, 5);
+  INP_GPIO(24);
+  INP_GPIO(25);
+
+  // enable pull-up on GPIO 24 & 25, see buttons.c
+  GPIO_PULL = 2;
+  short_wait();
+  GPIO_PULLCLK0 = 0x03000000;
+  short_wait();
+  GPIO_PULL = 0;
+  GPIO_PULLCLK0 = 0;
+} // setup_gpio
+
+void unpull_pins()
+{
+  GPIO_PULL = 0;
+  short_wait();
+  GPIO_PULLCLK0 = 0x03000000;
+  short_wait();
+  GPIO_PULL = 0;
+  GPIO_PULLCLK0 = 0;
+} // unpull_pins
+
+//
+// The tasks share these. They run one at a time, so no locks.
+// Variables a task needs after an AWAIT must not be locals.
+//
+static int pot = 512;     // last ADC value
+static int motor_on;
+static int led_dir = 1;
+
+//
+// Walk the LEDs
+//
+static unsigned long long led_next;
+static int led_pos;
+
+static int led_task(struct task *t)
+{
+  TASK_BEGIN(t);
+  led_next = get_time_ns();
+  while (1)
+  { GPIO_CLR0 = led_mask;
+    GPIO_SET0 = 1 << led_pin[led_pos];
+    led_pos = (led_pos + led_dir + N_LEDS) % N_LEDS;
+    led_next += LED_STEP;
+    AWAIT_UNTIL(t, led_next);
+  }
+  TASK_END(t);
+} // led_task
+
+//
+// B1: motor on/off, B2: reverse the LEDs
+// Sleep until one of the button pins has an edge (see gb_edge.c), then
+// let the bouncing die out: the buttons must read the same for
+// DEB_SAMPLES samples DEB_PERIOD apart before we act on them.
+// Without a kernel edge interface we have to look every DEB_PERIOD.
+//
+#define BUTTONS     0x03000000  // GPIO 24 & 25
+#define DEB_PERIOD  5000000     // ns
+#define DEB_SAMPLES 4
+
+static unsigned btn_state, btn_new, btn_pressed;
+static int btn_same;
+
+static int button_task(struct task *t)
+{
+  TASK_BEGIN(t);
+  btn_state = ~GPIO_IN0 & BUTTONS;  // active low: 1 is pressed
+  while (1)
+  { if (edge_fd() >= 0)
+      AWAIT_FD(t, edge_fd(), -1);
+    else
+      AWAIT_DELAY(t, DEB_PERIOD);
+    (void) wait_edge(0, NULL, NULL, NULL);  // clears edge_fd()
+    btn_new = ~GPIO_IN0 & BUTTONS;
+    if (btn_new == btn_state)
+      continue;
+    btn_same = 1;
+    while (btn_same < DEB_SAMPLES)
+    { AWAIT_DELAY(t, DEB_PERIOD);
+      (void) wait_edge(0, NULL, NULL, NULL);  // edges of the bouncing
+      if ((~GPIO_IN0 & BUTTONS) == btn_new)
+        btn_same++;
+      else
+      { btn_new = ~GPIO_IN0 & BUTTONS;
+        btn_same = 1;
+      }
+    }
+    btn_pressed = btn_new & ~btn_state;  // only act when pressed
+    btn_state = btn_new;
+    if (btn_pressed & 1<<25)
+    { motor_on = !motor_on;
+      printf("motor %s\n", motor_on ? "on" : "off");
+    }
+    if (btn_pressed & 1<<24)
+      led_dir = -led_dir;
+  }
+  TASK_END(t);
+} // button_task
+
+//
+// Read the pot, every 100 samples print what we saw
+//
+static unsigned long long adc_next;
+static int adc_n, adc_min, adc_max;
+static long adc_sum;
+
+static int adc_task(struct task *t)
+{
+  TASK_BEGIN(t);
+  adc_next = get_time_ns();
+  while (1)
+  { start_adc(0);
+    AWAIT_COND(t, spi_done(), SPI_POLL);
+    pot = finish_adc();
+
+    if (adc_n == 0 || pot < adc_min) adc_min = pot;
+    if (adc_n == 0 || pot > adc_max) adc_max = pot;
+    adc_sum += pot;
+    if (++adc_n == 100)
+    { printf("pot min %4d avg %4ld max %4d\n", adc_min, adc_sum/adc_n, adc_max);
+      adc_n = 0;
+      adc_sum = 0;
+    }
+    adc_next += ADC_PERIOD;
+    AWAIT_UNTIL(t, adc_next);
+  }
+  TASK_END(t);
+} // adc_task
+
+//
+// Let the motor follow the pot (see potmot.c)
+//
+static unsigned long long motor_next;
+static struct potctl pc;
+
+static int motor_task(struct task *t)
+{ int v, was_fwd;
+
+  TASK_BEGIN(t);
+  motor_next = get_time_ns();
+  while (1)
+  { if (motor_on)
+    { was_fwd = pc.fwd;
+      v = potctl_step(&pc, pot);
+      if (pc.fwd != was_fwd)
+      { if (pc.fwd)
+        { GPIO_CLR0 = 1<<17;
+          update_pwm0(v, PWM0_ENABLE);
+        }
+        else
+        { GPIO_SET0 = 1<<17;
+          update_pwm0(v, PWM0_ENABLE|PWM0_REVPOLAR);
+        }
+      }
+      else
+        // 20ms is many PWM periods, the last value has always been
+        // taken by now, so this one is never left pending (see set_pwm)
+        set_pwm0(v);
+    }
+    else if (pc.pwm || !pc.fwd)
+    { // stop: back to forward with power off
+      GPIO_CLR0 = 1<<17;
+      force_pwm0(0, PWM0_ENABLE);
+      setup_potctl(&pc, 2, BAND, 0);
+    }
+    motor_next += MOTOR_STEP;
+    AWAIT_UNTIL(t, motor_next);
+  }
+  TASK_END(t);
+} // motor_task
+
+//
+// q + enter stops everything
+//
+static char key_buf[64];
+
+static int key_task(struct task *t)
+{ int n;
+
+  TASK_BEGIN(t);
+  while (1)
+  { AWAIT_FD(t, 0, -1);
+    n = read(0, key_buf, sizeof(key_buf));
+    if (n <= 0 || memchr(key_buf, 'q', n) || memchr(key_buf, 'Q', n))
+      break;
+  }
+  stop_tasks();
+  TASK_END(t);
+} // key_task
+
+int main(void)
+{ struct task leds, butt, adc, motor, keys;
+
+  printf ("These are the connections for the multitask test:\n");
+  printf ("jumpers in U3-out-B3, U3-out-B4, U3-out-B5 and U3-out-B6\n");
+  printf ("GP25 in J2 --- B1 in J3\n");
+  printf ("GP24 in J2 --- B2 in J3\n");
+  printf ("GP23 in J2 --- B3 in J3\n");
+  printf ("GP22 in J2 --- B4 in J3\n");
+  printf ("GP21 in J2 --- B5 in J3\n");
+  printf ("GP4 in J2 --- B6 in J3\n");
+  printf ("jumper connecting GP11 to SCLK\n");
+  printf ("jumper connecting GP10 to MOSI\n");
+  printf ("jumper connecting GP9 to MISO\n");
+  printf ("jumper connecting GP8 to CSnA\n");
+  printf ("Potentiometer connections:\n");
+  printf ("  (call 1 and 3 the ends of the resistor and 2 the wiper)\n");
+  printf ("  connect 3 to 3V3\n");
+  printf ("  connect 2 to AD0\n");
+  printf ("  connect 1 to GND\n");
+  printf ("GP17 in J2 --- MOTB (just above GP1)\n");
+  printf ("GP18 in J2 --- MOTA (just above GP4)\n");
+  printf ("+ of external power source --- MOT+ in J19\n");
+  printf ("ground of external power source --- GND (any)\n");
+  printf ("one wire for your motor in MOTA in J19\n");
+  printf ("the other wire for your motor in MOTB in J19\n");
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  setup_gpio();
+  setup_spi();
+  GPIO_CLR0 = 1<<17;
+  setup_pwm(17);
+  force_pwm0(0, PWM0_ENABLE);
+  setup_potctl(&pc, 2, BAND, 0);
+
+  // the button task sleeps until the kernel sees an edge
+  // (if there is no edge interface it falls back to polling)
+  setup_edge(BUTTONS, EDGE_BOTH);
+
+  printf("B1: motor on/off, B2: reverse LEDs, q + enter: stop\n");
+  if (setup_tasks() == 0)
+  { add_task(&leds,  "leds",    led_task,    NULL);
+    add_task(&butt,  "buttons", button_task, NULL);
+    add_task(&adc,   "adc",     adc_task,    NULL);
+    add_task(&motor, "motor",   motor_task,  NULL);
+    add_task(&keys,  "keyboard", key_task,   NULL);
+    run_tasks();
+    print_task_stats();
+  }
+
+  // make sure everything is off
+  print_edge_stats();
+  restore_edge();
+  GPIO_CLR0 = led_mask | 1<<17;
+  pwm_off();
+  unpull_pins();
+  restore_io();
+  return 0;
+} // main
@@ -30,6 +30,8 @@
 //
 
 #include "gb_common.h"
+#include "gb_timeline.h"
+#include "gb_opts.h"
 
 
 // open colloector test GPIO mapping:
@@ -62,24 +64,30 @@ void setup_gpio(void)
 // send on/off signals to GPIO4 - it's the wiring on and off the board
 // that makes interesting things happen
 //
-int main(void)
-{ int p,r,last, chan;
+int main(int argc, char **argv)
+{ int chan;
+  unsigned long long half;
+  struct timeline tl;
+  struct gb_opts o;
 
-  do {
-    printf ("Which driver do you want to test?\n");
-    printf ("Type a number between 1 and 6.\n");
-    chan  = (int) getchar();
-    (void) getchar(); // eat carriage return
-  } while (chan < '1' | chan > '6');
-  chan = chan - '0';
+  // an iteration is one on/off cycle, by default 10 times
+  // 1 second on and 1 second off
+  setup_opts(&o, argc, argv, 10, 1, 6);
+  if (o.rate <= 0)
+    o.rate = 0.5;
+  chan = opts_channel(&o, "Which driver do you want to test?\n"
+                          "Type a number between 1 and 6.", 1, 6);
 
-  printf ("These are the connections for the open collector test:\n");
-  printf ("GP4 in J2 --- RLY%d in J4\n", chan);
-  printf ("+ of external power source --- RPWR in J6\n");
-  printf ("ground of external power source --- GND (any)\n");
-  printf ("ground side of your circuit --- RLY%d in J%d\n", chan, chan + 11);
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+  if (!o.batch)
+  {
+    printf ("These are the connections for the open collector test:\n");
+    printf ("GP4 in J2 --- RLY%d in J4\n", chan);
+    printf ("+ of external power source --- RPWR in J6\n");
+    printf ("ground of external power source --- GND (any)\n");
+    printf ("ground side of your circuit --- RLY%d in J%d\n", chan, chan + 11);
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
@@ -87,15 +95,24 @@ int main(void)
   // Set GPIO4 pin to output mode
   setup_gpio();
 
-  for (p = 0; p < 10; p++) {
-    GPIO_SET0 = 1 << 4;
-    long_wait(10);
-    GPIO_CLR0 = 1 << 4;
-    long_wait(10);
+  // on for half the period, off for the other half
+  // the player thread (see gb_timeline.c) does the timing,
+  // next_iteration() starts every cycle on time
+  half = (unsigned long long)(0.5e9 / o.rate);
+  setup_timeline(&tl);
+  timeline_event(&tl, 0, 1 << 4, 0);
+  timeline_event(&tl, half, 0, 1 << 4);
+  compile_timeline(&tl, 0, 0);
+  if (start_player(0) == 0) {
+    while (next_iteration(&o)) {
+      queue_timeline(&tl);
+      wait_player();
+    }
+    stop_player();
   }
+  free_timeline(&tl);
+  GPIO_CLR0 = 1 << 4;
 
+  print_summary(&o);
   restore_io();
 } // main
-
-
-
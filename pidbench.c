@@ -0,0 +1,143 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// PID controller benchmark
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Measure how long one step of the fixed-point PID controller
+// (gb_pid.c) takes. No Gertboard needed, it runs on any Linux box.
+//
+// To make it fair the inputs come from a small motor model: a DC motor
+// driving a pot, the controller tries to hold it at a setpoint which
+// jumps every 1000 steps. The model is run for every step as well, so
+// we first time the model on its own and subtract that.
+//
+//   ./pidbench -n 10000000 -k 4
+//
+
+#include "gb_common.h"
+#include "gb_pid.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_PID 64
+
+// A very simple plant: the pot position follows the PWM value (with
+// 512 standing still) with some inertia. Integers only, like the PID.
+struct plant {
+  int pos;   // 0..1023, << 8
+  int vel;   // << 8
+};
+
+static int plant_step(struct plant *m, int pwm)
+{
+  m->vel += ((pwm - 512) * 4 - m->vel) >> 4;
+  m->pos += m->vel >> 2;
+  if (m->pos < 0)          { m->pos = 0;          m->vel = 0; }
+  if (m->pos > 1023 << 8)  { m->pos = 1023 << 8;  m->vel = 0; }
+  return m->pos >> 8;
+} // plant_step
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-n steps] [-k controllers (max. %d)]\n",
+          prog, MAX_PID);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ struct pid pid[MAX_PID];
+  struct plant m[MAX_PID];
+  int c, k, n_pid, in, out[MAX_PID], sp;
+  long i, n;
+  unsigned long long t0, t_model, t_total;
+  long long sum;
+
+  n = 10000000;
+  n_pid = 4;
+  while ((c = getopt(argc, argv, "n:k:")) != -1)
+  {
+    switch (c)
+    {
+    case 'n' : n     = atol(optarg); break;
+    case 'k' : n_pid = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (n <= 0 || n_pid < 1 || n_pid > MAX_PID)
+    usage(argv[0]);
+
+  // model only: what the loop costs without the controller
+  for (k = 0; k < n_pid; k++)
+  { m[k].pos = m[k].vel = 0;
+    out[k] = 512;
+  }
+  sum = 0;
+  t0 = get_time_ns();
+  for (i = 0; i < n; i++)
+  { sp = (i / 1000) & 1 ? 800 : 200;
+    for (k = 0; k < n_pid; k++)
+    { in = plant_step(&m[k], out[k]);
+      out[k] = (in + sp) >> 1;   // something cheap that depends on in
+      sum += out[k];
+    }
+  }
+  t_model = get_time_ns() - t0;
+
+  // model + controllers, with a different gain set for every instance
+  for (k = 0; k < n_pid; k++)
+  { setup_pid(&pid[k], PID_GAIN(2.0) + k*PID_GAIN(0.1), PID_GAIN(0.02),
+              PID_GAIN(8.0), 3, 0, 1024);
+    m[k].pos = m[k].vel = 0;
+    out[k] = 512;
+  }
+  t0 = get_time_ns();
+  for (i = 0; i < n; i++)
+  { sp = (i / 1000) & 1 ? 800 : 200;
+    for (k = 0; k < n_pid; k++)
+    { in = plant_step(&m[k], out[k]);
+      out[k] = pid_step(&pid[k], sp, in);
+      sum += out[k];
+    }
+  }
+  t_total = get_time_ns() - t0;
+
+  printf("%ld steps of %d controllers\n", n, n_pid);
+  printf("model only      : %.1f ns per step\n",
+         (double)t_model / n / n_pid);
+  printf("model + PID     : %.1f ns per step\n",
+         (double)t_total / n / n_pid);
+  printf("PID step        : %.1f ns\n",
+         ((double)t_total - t_model) / n / n_pid);
+  printf("final positions :");
+  for (k = 0; k < n_pid; k++)
+    printf(" %d", m[k].pos >> 8);
+  printf(" (setpoint %d, checksum %lld)\n", (n-1)/1000 & 1 ? 800 : 200, sum);
+  return 0;
+} // main
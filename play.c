@@ -0,0 +1,156 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Play sound files (or bit patterns) on the PWM
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Play a WAV file on the PWM output(s). The samples are streamed to the
+// PWM FIFO (see gb_stream.c), the PWM does the timing, not the CPU.
+// Channel 0 comes out on GPIO18 (GP18 in J2), channel 1 on GPIO19
+// which is only on the 40-pin header of the newer boards.
+//
+//   sudo ./play -P 50 sound.wav
+//   sudo ./play -r 8000 -b 8 sound.raw             (raw 8-bit mono)
+//   sudo ./play -s -r 1000000 -l -t 5 pattern.bin  (32-bit words, 1Mbit/s)
+//
+
+#include "gb_common.h"
+#include "gb_rt.h"
+#include "gb_pwm.h"
+#include "gb_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// play GPIO mapping:
+//         Function            Mode
+// GPIO18= PWM channel 0       Alt5
+// GPIO19= PWM channel 1       Alt5 (only with -o 2 or -o 3)
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-o 1|2|3] [-n min_steps] [-l] [-t seconds] [-P rt_prio]\n"
+    "          [-r rate_hz -b 8|16 -c 1|2] [-s] file\n"
+    "  -o PWM channels to use: 1 = channel 0, 2 = channel 1, 3 = both\n"
+    "  -r -b -c describe a raw file (a WAV file has them in its header)\n"
+    "  -s serial mode: the file holds 32-bit words, -r is the bit rate\n",
+    prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, prio;
+  unsigned steps;
+  double secs;
+  struct pwm_stream ps;
+  struct stream_stats st;
+  struct timespec ts;
+  unsigned long long t0;
+
+  memset(&ps, 0, sizeof(ps));
+  ps.out      = 1;
+  ps.rate     = 8000;
+  ps.bits     = 8;
+  ps.channels = 1;
+  steps = 256;
+  secs  = 0;   // until the end of the file
+  prio  = 0;
+
+  while ((c = getopt(argc, argv, "o:n:lt:P:r:b:c:s")) != -1)
+  {
+    switch (c)
+    {
+    case 'o' : ps.out      = atoi(optarg); break;
+    case 'n' : steps       = atoi(optarg); break;
+    case 'l' : ps.loop     = 1; break;
+    case 't' : secs        = atof(optarg); break;
+    case 'P' : prio        = atoi(optarg); break;
+    case 'r' : ps.rate     = atof(optarg); break;
+    case 'b' : ps.bits     = atoi(optarg); break;
+    case 'c' : ps.channels = atoi(optarg); break;
+    case 's' : ps.serial   = 1; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (optind != argc-1 || ps.out < 1 || ps.out > 3 || ps.rate <= 0 ||
+      steps < 2 || (ps.loop && secs <= 0))
+    usage(argv[0]);
+
+  printf ("These are the connections for the PWM player:\n");
+  if (ps.out & 1)
+    printf ("GP18 in J2 --- low-pass filter, amplifier or scope\n");
+  if (ps.out & 2)
+    printf ("GPIO19 (pin 35 of the 40-pin header) --- second output\n");
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  if (ps.out & 1)
+  { INP_GPIO(18);  SET_GPIO_ALT(18, 5);
+  }
+  if (ps.out & 2)
+  { INP_GPIO(19);  SET_GPIO_ALT(19, 5);
+  }
+
+  // The feeder thread inherits the real-time profile
+  if (prio)
+    setup_rt(RT_DEFAULT, prio, 0);
+
+  if (start_stream(argv[optind], &ps, steps))
+  { restore_io();
+    return EXIT_FAILURE;
+  }
+  printf("Playing %s\n", argv[optind]);
+  t0 = get_time_ns();
+  ts.tv_sec  = 0;
+  ts.tv_nsec = 100000000;
+  while (stream_busy() && (secs <= 0 || get_time_ns() - t0 < secs * 1e9))
+    nanosleep(&ts, NULL);
+  stop_stream(&st);
+
+  if (prio)
+    restore_rt();
+  // back to inputs
+  if (ps.out & 1)
+    INP_GPIO(18);
+  if (ps.out & 2)
+    INP_GPIO(19);
+  restore_io();
+
+  printf("%.1f %s, %u steps\n", st.hz, ps.serial ? "bit/s" : "Hz", st.range);
+  printf("%llu words in %.3f s, %llu wake-ups\n",
+         st.words, st.ns/1e9, st.refills);
+  if (st.underruns)
+    printf("Warning: %llu FIFO underruns (try -P)\n", st.underruns);
+  return 0;
+} // main
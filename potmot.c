@@ -31,6 +31,10 @@
 #include "gb_common.h"
 #include "gb_spi.h"
 #include "gb_pwm.h"
+#include "gb_rt.h"
+#include "gb_loop.h"
+#include "gb_potctl.h"
+#include "gb_opts.h"
 
 // potentiometer - motor test GPIO mapping:
 //         Function            Mode
@@ -68,31 +72,113 @@ void setup_gpio(void)
 } // setup_gpio
 
 
-void main()
-{ int r, s, v, fwd;
-
-  printf ("These are the connections for the potentiometer - motor test:\n");
-  printf ("jumper connecting GP11 to SCLK\n");
-  printf ("jumper connecting GP10 to MOSI\n");
-  printf ("jumper connecting GP9 to MISO\n");
-  printf ("jumper connecting GP8 to CSnA\n");
-  printf ("Potentiometer connections:\n");
-  printf ("  (call 1 and 3 the ends of the resistor and 2 the wiper)\n");
-  printf ("  connect 3 to 3V3\n");
-  printf ("  connect 2 to AD0\n");
-  printf ("  connect 1 to GND\n");
-  printf ("GP17 in J2 --- MOTB (just above GP1)\n");
-  printf ("GP18 in J2 --- MOTA (just above GP4)\n");
-  printf ("+ of external power source --- MOT+ in J19\n");
-  printf ("ground of external power source --- GND (any)\n");
-  printf ("one wire for your motor in MOTA in J19\n");
-  printf ("the other wire for your motor in MOTB in J19\n");
-  printf ("When ready hit enter.\n");
-  (void) getchar();
+//
+// Keep track of how long direction changes take to reach the motor
+//
+static int  changes, failed;
+static long lat_max, lat_sum;
+
+static void note_latency(long lat)
+{
+  if (lat < 0)
+  { failed++;
+    return;
+  }
+  changes++;
+  lat_sum += lat;
+  if (lat > lat_max)
+    lat_max = lat;
+} // note_latency
+
+//
+// One cycle of the control loop: read the pot, set the motor
+//
+#define PERIOD 1000000  // ns, 1kHz
+#define BAND   8        // hysteresis around the middle of the pot
+
+static int potmot_step(struct ctl_loop *l, void *arg)
+{ struct potctl *pc = arg;
+  int v, fwd, was_fwd;
+
+  v = read_adc(0);
+  loop_input(l);
+  was_fwd = pc->fwd;
+  v = potctl_step(pc, v);  // see gb_potctl.c
+  fwd = pc->fwd;
+
+  if (fwd != was_fwd)
+  { // going in the wrong direction: reverse polarity
+    if (fwd)
+    { GPIO_CLR0 = 1<<17;
+      // Now normal polarity works for us: 
+      // With a low v sent to PWM we get a low duty cycle, power
+      // is off most of the time, and since motor b input is low this 
+      // means a slow motor; when v goes to near 1023 we get a high duty
+      // cycle which means power on most of the time which results in 
+      // motor going quickly
+      note_latency(update_pwm0(v,PWM0_ENABLE));
+    }
+    else
+    { GPIO_SET0 = 1<<17;
+      // We set PWM0_REVPOLAR flag below because normally a high value for
+      // v means high cycle which means signal high most of the time.
+      // But with motor input B high, this would mean that motor is slow,
+      // which is not what we want. Setting PWM0_REVPOLAR flips the 
+      // polarity so that a high v means that the signal is low most
+      // of the time, which gives us a high speed.
+      note_latency(update_pwm0(v,PWM0_ENABLE|PWM0_REVPOLAR));
+    }
+  }
+  else if (!set_pwm0(v))
+    // the PWM (586Hz) has not taken the last value yet, this one is
+    // pending and the next step writes a newer one: no output time
+    return 0;
+  loop_output(l);
+  return 0;
+} // potmot_step
+
+void main(int argc, char **argv)
+{ struct ctl_loop loop;
+  struct potctl pc;
+  struct gb_opts o;
+  unsigned long period;
+  unsigned long long cycles;
+
+  // an iteration is one cycle of the control loop, 30s at 1kHz by default
+  setup_opts(&o, argc, argv, 30000000000ULL / PERIOD, 1, 0);
+  period = o.rate > 0 ? (unsigned long)(1e9 / o.rate) : PERIOD;
+  cycles = o.count;
+  if (o.seconds > 0 && (!cycles || o.seconds * 1e9 / period < cycles))
+    cycles = (unsigned long long)(o.seconds * 1e9 / period);
+
+  if (!o.batch)
+  {
+    printf ("These are the connections for the potentiometer - motor test:\n");
+    printf ("jumper connecting GP11 to SCLK\n");
+    printf ("jumper connecting GP10 to MOSI\n");
+    printf ("jumper connecting GP9 to MISO\n");
+    printf ("jumper connecting GP8 to CSnA\n");
+    printf ("Potentiometer connections:\n");
+    printf ("  (call 1 and 3 the ends of the resistor and 2 the wiper)\n");
+    printf ("  connect 3 to 3V3\n");
+    printf ("  connect 2 to AD0\n");
+    printf ("  connect 1 to GND\n");
+    printf ("GP17 in J2 --- MOTB (just above GP1)\n");
+    printf ("GP18 in J2 --- MOTA (just above GP4)\n");
+    printf ("+ of external power source --- MOT+ in J19\n");
+    printf ("ground of external power source --- GND (any)\n");
+    printf ("one wire for your motor in MOTA in J19\n");
+    printf ("the other wire for your motor in MOTB in J19\n");
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
 
   // Map the I/O sections
   setup_io();
 
+  // Optional real-time profile, see gb_rt.c
+  setup_rt_env();
+
   // Set up GPIO pins for both A/D and motor
   setup_gpio();
 
@@ -105,69 +191,39 @@ void main()
 
   // motor B input is still low, so motor gets power when pwm input A is high
   force_pwm0(0,PWM0_ENABLE);
-  // we call "forward" the direction we get when the B input is high
-  // we start out set up for going "backwards"
-  fwd = 0;
+  // We call "forward" the direction we get with motor B input low,
+  // that is where we start. Average over about 4 samples against noise
+  // on the A/D input and use hysteresis around the middle of the pot.
+  setup_potctl(&pc, 2, BAND, 0);
 
-  for (r=0; r<1200000; r++)
-  {
-    v= read_adc(0);
-    if (v <= 511)
-      { 
-      // map 0 to 511 to going "backwards" -- 0 (one end of your pot) means
-      // go backwards fast (v sent to PWM is near 1023), as we increase 
-      // towards 510, motor speed slows, and at 511 (middle) motor is stopped
-      // (v sent to PWM is near 0)
-      v = 1023-(v * 2);
-      // we want v near 0 to mean motor slow/stopped and v near 1023 to
-      // mean motor going "backwards" fast
-      if (fwd)
-      { // going in the wrong direction
-        // reverse polarity
-        GPIO_SET0 = 1<<17;
-	// We set PWM0_REVPOLAR flag below because normally a high value for
-	// v means high cycle which means signal high most of the time.
-	// But with motor input B high, this would mean that motor is slow,
-        // which is not what we want. Setting PWM0_REVPOLAR flips the 
-	// polarity so that a high v means that the signal is low most
-	// of the time, which gives us a high speed.
-        force_pwm0(v,PWM0_ENABLE|PWM0_REVPOLAR);
-        fwd = 0;
-      }
-      else
-        set_pwm0(v);
-    }
-    else
-    {   
-      // map A/D value of 512 to 1023 to going "forwards" -- at 512 (middle)
-      // motor is stopped (v sent to PWM is near 0), as we increase A/D value
-      // motor speed increases (in the "forwards" direction), and when A/D
-      // value is at 1023 (at the "other" end of your pot), we send PWM a
-      // value near 1023 so it goes very fast "forwards".
-      v = (v-512)*2;
-      if (!fwd)
-      { // going in the wrong direction
-        // reverse polarity
-        GPIO_CLR0 = 1<<17;
-	// Now normal polarity works for us: 
-	// With a low v sent to PWM we get a low duty cycle, power
-        // is off most of the time, and since motor b input is low this 
-	// means a slow motor; when v goes to near 1023 we get a high duty
-	// cycle which means power on most of the time which results in 
-	// motor going quickly
-        force_pwm0(v,PWM0_ENABLE);
-        fwd = 1;
-      }
-      else
-        set_pwm0(v);
-    }
-    short_wait();
-  } // repeated read
+  // run the control step every 1ms for 30 seconds (or what -n, -t
+  // and -r ask for), run_loop does the pacing itself
+  setup_loop(&loop, period, 0, 1000);
+  run_loop(&loop, potmot_step, &pc, cycles);
 
   // set motor A and B inputs to 0 so motor stops
   GPIO_CLR0 = 1<<17;
   force_pwm0(0,PWM0_ENABLE);
 
+  print_loop_stats(&loop, 1);
+  if (changes)
+    printf("%d direction changes, PWM update took avg %ld max %ld us\n",
+           changes, lat_sum/changes/1000, lat_max/1000);
+  if (failed)
+    printf("%d PWM updates did not arrive\n", failed);
+
+  // the loop kept its own statistics, report those. Its latency is
+  // input to output within a step, not the time of an iteration.
+  o.done    = loop.cycles;
+  o.ns      = loop.ns;
+  o.late    = loop.overruns;
+  o.lat_n   = loop.lat_n;
+  o.lat_min = loop.lat_min;
+  o.lat_max = loop.lat_max;
+  o.lat_sum = loop.lat_sum;
+  o.lat_key = "io_lat";
+  print_summary(&o);
 
+  restore_rt();
   restore_io();
 }
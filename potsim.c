@@ -0,0 +1,424 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Potentiometer - motor simulator
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Tuning potmot on the real board means turning the pot and watching
+// the motor. This program runs the same control code (gb_potctl.c)
+// against a model of the H-bridge and a DC motor instead, much faster
+// than real time, for a whole range of filter, hysteresis and slew
+// settings at once (one thread per CPU core). The settings are ranked
+// by how quickly and cleanly the motor speed follows the pot.
+//
+// No Gertboard needed, it runs on any Linux box:
+//   ./potsim                    (synthetic pot movements, 3 counts noise)
+//   ./potsim -n 8 -k 20         (more noise, show the best 20)
+//   ./potsim -f pot.txt         (recorded A/D values, one per line, 1kHz)
+//
+// The model:
+//  - potmot runs its step every 1ms; the PWM value it writes is used
+//    from the next step on (the PWM picks it up at the end of a period)
+//  - H-bridge: forward (B low) the motor gets +Vs for pwm/1024 of the
+//    time, backward (B high, PWM0_REVPOLAR) it gets -Vs for pwm/1024 of
+//    the time. The PWM itself is much faster than the motor so we use
+//    the average voltage.
+//  - DC motor: L di/dt = V - R i - Ke w   (w is the speed, Ke w the
+//              J dw/dt = Kt i - b w        back-EMF, J the inertia)
+//
+// For every stretch where the pot stands still we look at the speed
+// step it asks for and measure the settling time (until the speed
+// stays within 5% of the step) and the overshoot. Direction changes
+// on top of the ones the pot asks for count as chatter.
+// Most of the settling time is the motor itself (about 0.2 s), the
+// same for every setting. So we first run the trace without noise,
+// filter or slew (the PWM value potctl_ideal() gives at once) and only
+// count the time a setting takes beyond that:
+//   score = avg. extra settling time (ms) + 2 * max. overshoot (%)
+//           + 20 * chatter
+// Lower is better.
+//
+
+#include "gb_common.h"
+#include "gb_loop.h"
+#include "gb_potctl.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define STEP_S    0.001   // control period
+#define SUB_STEPS 10      // motor model steps per control period
+
+// a 6V hobby motor
+#define VS  6.0       // V
+#define R   2.0       // ohm
+#define L   0.001     // H
+#define KE  0.01      // V per rad/s (and Kt in Nm/A)
+#define J   0.00001   // kg m^2
+#define B   0.000001  // Nm per rad/s
+
+struct candidate {
+  int shift, band, slew;
+  double settle;     // avg. settling time beyond the reference, ms
+  double overshoot;  // max. overshoot, %
+  int chatter;       // extra direction changes
+  int unsettled;     // steps which never settled
+  double score;
+};
+
+static int *trace;   // A/D value for every ms (with noise)
+static int *clean;   // same without noise, used to find the steps
+static int n_trace;
+
+// The stretches where the pot stands still and the speed step they
+// ask for, with the settling time of the reference run
+struct segment {
+  int start, end;    // ms
+  double target;     // speed at the end of the step
+  double step;       // change of the target speed
+  double ref_settle; // ms
+};
+static struct segment *segs;
+static int n_segs, ideal_dirs;
+static struct candidate *cand;
+static int n_cand, next_cand;
+
+//
+// The speed the motor ends up at for a constant signed PWM value
+//
+static double steady_speed(int pwm)
+{
+  return KE * VS * pwm / 1024.0 / (R * B + KE * KE);
+} // steady_speed
+
+//
+// Run the motor model for one control period at average voltage v
+//
+static void motor_step(double v, double *i, double *w)
+{ double dt;
+  int s;
+
+  dt = STEP_S / SUB_STEPS;
+  for (s = 0; s < SUB_STEPS; s++)
+  { *i += (v - R * *i - KE * *w) / L * dt;
+    *w += (KE * *i - B * *w) / J * dt;
+  }
+} // motor_step
+
+//
+// How long speed[] takes to settle on segment g, ms
+// If over is not NULL it gets the overshoot in % of the step
+//
+static double settle_time(const double *speed, const struct segment *g,
+                          double *over)
+{ double tol, err, max_err;
+  int k, last_out;
+
+  tol = 0.05 * fabs(g->step);
+  last_out = g->start - 1;
+  max_err = 0;
+  for (k = g->start; k < g->end; k++)
+  { err = speed[k] - g->target;
+    if (err > tol || err < -tol)
+      last_out = k;
+    err = g->step > 0 ? err : -err;
+    if (err > max_err)
+      max_err = err;
+  }
+  if (over)
+    *over = max_err * 100 / fabs(g->step);
+  return (last_out + 1 - g->start) * STEP_S * 1000;
+} // settle_time
+
+//
+// Find the steps in the clean trace and how fast the motor follows
+// them at best: the ideal PWM value from the next step on, no noise,
+// no filter, no slew
+// Returns 0 on success
+//
+static int setup_reference()
+{ double *speed, w, i, max_w, target, prev_target;
+  int k, seg, seg_start, pwm, seg_dir, prev_dir;
+
+  speed = malloc(n_trace * sizeof(double));
+  segs  = malloc(n_trace * sizeof(struct segment));
+  if (!speed || !segs)
+    return -1;
+  w = i = 0;
+  pwm = 0;
+  for (k = 0; k < n_trace; k++)
+  { motor_step(VS * pwm / 1024.0, &i, &w);
+    speed[k] = w;
+    pwm = potctl_ideal(clean[k]);
+  }
+
+  max_w = steady_speed(1023);
+  n_segs = ideal_dirs = 0;
+  prev_dir = 1;
+  prev_target = 0;
+  for (seg_start = 0; seg_start < n_trace; seg_start = seg)
+  { for (seg = seg_start+1; seg < n_trace; seg++)
+      if (abs(clean[seg] - clean[seg_start]) > 20)
+        break;
+    target  = steady_speed(potctl_ideal(clean[seg_start]));
+    seg_dir = potctl_ideal(clean[seg_start]) > 0 ? 1 :
+              potctl_ideal(clean[seg_start]) < 0 ? 0 : prev_dir;
+    if (seg_dir != prev_dir)
+      ideal_dirs++;
+    prev_dir = seg_dir;
+    segs[n_segs].start  = seg_start;
+    segs[n_segs].end    = seg;
+    segs[n_segs].target = target;
+    segs[n_segs].step   = target - prev_target;
+    prev_target = target;
+    if (fabs(segs[n_segs].step) < 0.05*max_w)
+      continue; // not much of a step
+    segs[n_segs].ref_settle = settle_time(speed, &segs[n_segs], NULL);
+    n_segs++;
+  }
+  free(speed);
+  return 0;
+} // setup_reference
+
+//
+// Run one candidate over the whole trace and score it
+//
+static void simulate(struct candidate *c)
+{ struct potctl pc;
+  double w, i, t, over, settle_sum, over_max;
+  int k, g, pwm, fwd, prev_fwd, dirs;
+  double *speed;
+
+  if ((speed = malloc(n_trace * sizeof(double))) == NULL)
+  { c->score = HUGE_VAL;  // not run: rank it last
+    return;
+  }
+  setup_potctl(&pc, c->shift, c->band, c->slew);
+  w = i = 0;
+  pwm = 0; fwd = 1; prev_fwd = 1; dirs = 0;
+  for (k = 0; k < n_trace; k++)
+  { // the value written last step is what the PWM does now
+    motor_step((fwd ? VS : -VS) * pwm / 1024.0, &i, &w);
+    speed[k] = w;
+    pwm = potctl_step(&pc, trace[k]);
+    fwd = pc.fwd;
+    if (fwd != prev_fwd && pwm)
+    { dirs++;
+      prev_fwd = fwd;
+    }
+  }
+
+  // score every stretch where the pot stands (nearly) still
+  settle_sum = over_max = 0;
+  c->unsettled = 0;
+  for (g = 0; g < n_segs; g++)
+  { t = settle_time(speed, &segs[g], &over);
+    if (t >= (segs[g].end - segs[g].start) * STEP_S * 1000)
+      c->unsettled++;
+    if (t > segs[g].ref_settle)
+      settle_sum += t - segs[g].ref_settle;
+    if (over > over_max)
+      over_max = over;
+  }
+  free(speed);
+
+  c->settle    = n_segs ? settle_sum / n_segs : 0;
+  c->overshoot = over_max;
+  c->chatter   = dirs > ideal_dirs ? dirs - ideal_dirs : 0;
+  c->score     = c->settle + 2 * c->overshoot + 20 * c->chatter;
+} // simulate
+
+//
+// Worker thread: take the next candidate until there are none left
+//
+static void *worker(void *arg)
+{ int k;
+  while ((k = __atomic_fetch_add(&next_cand, 1, __ATOMIC_RELAXED)) < n_cand)
+    simulate(&cand[k]);
+  return NULL;
+} // worker
+
+static int cmp_score(const void *a, const void *b)
+{ const struct candidate *x = a, *y = b;
+  if (x->score < y->score) return -1;
+  if (x->score > y->score) return 1;
+  return 0;
+} // cmp_score
+
+//
+// Synthetic pot movements: hold a position, jump to the next
+//
+static int make_trace(int noise)
+{ static const int pos[]  = {512, 900, 100, 620, 505, 1023, 0, 400, 512};
+  static const int hold[] = {1000, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500};
+  unsigned rnd;
+  int p, k, n, v;
+
+  n = 0;
+  for (p = 0; p < (int)(sizeof(hold)/sizeof(hold[0])); p++)
+    n += hold[p];
+  trace = malloc(n * sizeof(int));
+  clean = malloc(n * sizeof(int));
+  if (!trace || !clean)
+    return -1;
+  rnd = 12345;
+  n = 0;
+  for (p = 0; p < (int)(sizeof(hold)/sizeof(hold[0])); p++)
+    for (k = 0; k < hold[p]; k++)
+    { rnd = rnd * 1103515245 + 12345;
+      v = pos[p];
+      if (noise)
+        v += (int)((rnd >> 16) % (2*noise+1)) - noise;
+      if (v < 0) v = 0;
+      if (v > 1023) v = 1023;
+      clean[n] = pos[p];
+      trace[n++] = v;
+    }
+  n_trace = n;
+  return 0;
+} // make_trace
+
+//
+// Recorded A/D values, one per line
+//
+static int read_trace(const char *file)
+{ FILE *fp;
+  int v, size;
+
+  if ((fp = fopen(file, "r")) == NULL)
+  { printf("Can't open %s\n", file);
+    return -1;
+  }
+  size = 0;
+  n_trace = 0;
+  while (fscanf(fp, "%d", &v) == 1)
+  { if (n_trace == size)
+    { size = size ? 2*size : 4096;
+      if ((trace = realloc(trace, size * sizeof(int))) == NULL)
+      { fclose(fp);
+        return -1;
+      }
+    }
+    trace[n_trace++] = v < 0 ? 0 : v > 1023 ? 1023 : v;
+  }
+  fclose(fp);
+  clean = trace; // the steps are found in the recording itself
+  return n_trace ? 0 : -1;
+} // read_trace
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-f trace_file] [-n noise] [-j threads] [-k best_n]\n", prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ static const int shifts[] = {0, 1, 2, 3, 4, 5};
+  static const int bands[]  = {0, 2, 4, 8, 16, 32};
+  static const int slews[]  = {0, 1, 2, 4, 8, 16, 32};
+  int c, a, b, s, k, n_threads, noise, best;
+  char *file;
+  pthread_t *th;
+  unsigned long long t0, ns;
+
+  file = NULL;
+  noise = 3;
+  best = 10;
+  n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  while ((c = getopt(argc, argv, "f:n:j:k:")) != -1)
+  {
+    switch (c)
+    {
+    case 'f' : file      = optarg; break;
+    case 'n' : noise     = atoi(optarg); break;
+    case 'j' : n_threads = atoi(optarg); break;
+    case 'k' : best      = atoi(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (noise < 0 || best < 1)
+    usage(argv[0]);
+  if (n_threads < 1)
+    n_threads = 1;
+
+  if (file ? read_trace(file) : make_trace(noise))
+  { printf("No trace to run\n");
+    return EXIT_FAILURE;
+  }
+  if (setup_reference())
+  { printf("allocation error \n");
+    return EXIT_FAILURE;
+  }
+
+  n_cand = sizeof(shifts)/sizeof(int) * sizeof(bands)/sizeof(int)
+         * sizeof(slews)/sizeof(int);
+  cand = calloc(n_cand, sizeof(struct candidate));
+  th   = malloc(n_threads * sizeof(pthread_t));
+  if (!cand || !th)
+  { printf("allocation error \n");
+    return EXIT_FAILURE;
+  }
+  k = 0;
+  for (a = 0; a < (int)(sizeof(shifts)/sizeof(int)); a++)
+    for (b = 0; b < (int)(sizeof(bands)/sizeof(int)); b++)
+      for (s = 0; s < (int)(sizeof(slews)/sizeof(int)); s++)
+      { cand[k].shift = shifts[a];
+        cand[k].band  = bands[b];
+        cand[k].slew  = slews[s];
+        k++;
+      }
+
+  t0 = get_time_ns();
+  next_cand = 0;
+  for (k = 0; k < n_threads; k++)
+    if (pthread_create(&th[k], NULL, worker, NULL))
+    { n_threads = k;
+      break;
+    }
+  if (n_threads == 0)
+    worker(NULL);
+  for (k = 0; k < n_threads; k++)
+    pthread_join(th[k], NULL);
+  ns = get_time_ns() - t0;
+
+  qsort(cand, n_cand, sizeof(struct candidate), cmp_score);
+  printf("%d settings x %.1f s of pot movements in %.3f s on %d threads"
+         " (%.0f x real time)\n", n_cand, n_trace * STEP_S, ns/1e9,
+         n_threads ? n_threads : 1, n_cand * n_trace * STEP_S / (ns/1e9));
+  printf("rank  filter  band  slew  +settle(ms)  overshoot(%%)  chatter  score\n");
+  for (k = 0; k < best && k < n_cand; k++)
+    printf("%4d  %6d  %4d  %4d  %11.1f  %12.1f  %7d  %5.1f%s\n", k+1,
+           cand[k].shift, cand[k].band, cand[k].slew, cand[k].settle,
+           cand[k].overshoot, cand[k].chatter, cand[k].score,
+           cand[k].unsettled ? "  (not always settled)" : "");
+  return 0;
+} // main
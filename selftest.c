@@ -0,0 +1,533 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Board self-test
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Check a whole board in one go. Every part is looped back into the
+// Pi so we can see if what we send out comes back:
+//   gpio : GP25 drives GP24
+//   dac  : the D to A output goes to the A to D input, all 256 codes
+//   pwm  : the PWM output GP18 goes to GP23, we measure the duty cycle
+//   ocol : GP4 switches open collector driver 1, its output pulls GP22 low
+// Each test says PASS or FAIL and leaves a few numbers (how fast, how
+// late, how far off). Those can be written to a results file and
+// compared with the results of a board or kernel we trust:
+//   sudo ./selftest -b -o good.txt             (on the good set-up)
+//   sudo ./selftest -b -B good.txt             (later, or on a new board)
+// A number which is worse than the baseline by more than the tolerance
+// counts as a regression. The program exits with an error if a test
+// failed or something regressed, so scripts can use it.
+//
+
+#include "gb_common.h"
+#include "gb_spi.h"
+#include "gb_pwm.h"
+#include "gb_rt.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// selftest GPIO mapping:
+//         Function            Mode
+// GPIO4=  open collector      Output          (ocol)
+// GPIO7=  SPI chip select B   Alt. 0          (dac)
+// GPIO8=  SPI chip select A   Alt. 0          (dac)
+// GPIO9=  SPI MISO            Alt. 0          (dac)
+// GPIO10= SPI MOSI            Alt. 0          (dac)
+// GPIO11= SPI CLK             Alt. 0          (dac)
+// GPIO18= PWM                 alt ftn 5       (pwm)
+// GPIO22= open collector back Input, pull-up  (ocol)
+// GPIO23= PWM back            Input           (pwm)
+// GPIO24= loopback input      Input           (gpio)
+// GPIO25= loopback output     Output          (gpio)
+
+#define GPIO_OUT     25
+#define GPIO_IN      24
+#define GPIO_TIMEOUT 1000000   // ns for a level to come back
+
+#define DAC_CHAN     1
+#define ADC_CHAN     0
+#define DAC_READS    4         // ADC reads averaged per DAC code
+#define DAC_TOL      20        // ADC steps, DAC gain error is up to 2%
+
+#define PWM_IN       23
+#define PWM_HZ       100
+#define PWM_PERIODS  20        // periods measured per duty cycle
+#define DUTY_TOL     2.0       // percent
+
+#define OC_OUT       4
+#define OC_IN        22
+#define OC_TIMEOUT   10000000  // ns, the pull-up is slow
+#define OC_CYCLES    100
+
+#define MAX_ERRORS   10        // stop a test after this many
+
+//
+// The numbers every test leaves behind. 'better' is 1 if a higher value
+// is better, -1 if a lower value is. A number has regressed if it is
+// worse than the baseline by more than the tolerance (percent) plus
+// 'slack', which keeps values close to 0 from flagging on noise.
+//
+struct metric {
+  const char *name;
+  int better;
+  double slack;
+  double value;
+  int valid;
+};
+
+static struct metric metrics[] = {
+  { "gpio.toggle_rate",   1, 0,   0, 0 }, // verified writes per second
+  { "gpio.loop_avg_us",  -1, 0.2, 0, 0 },
+  { "gpio.loop_max_us",  -1, 20,  0, 0 },
+  { "dac.sweep_ms",      -1, 1,   0, 0 }, // 256 codes, DAC_READS reads each
+  { "dac.err_avg_lsb",   -1, 1,   0, 0 },
+  { "dac.err_max_lsb",   -1, 2,   0, 0 },
+  { "pwm.duty_err_pct",  -1, 0.5, 0, 0 },
+  { "pwm.update_avg_us", -1, 100, 0, 0 },
+  { "ocol.on_avg_us",    -1, 5,   0, 0 },
+  { "ocol.off_avg_us",   -1, 20,  0, 0 },
+};
+#define N_METRICS (int)(sizeof(metrics)/sizeof(metrics[0]))
+
+static void set_metric(const char *name, double v)
+{ int i;
+  for (i = 0; i < N_METRICS; i++)
+    if (!strcmp(metrics[i].name, name))
+    { metrics[i].value = v;
+      metrics[i].valid = 1;
+    }
+} // set_metric
+
+//
+// Write to the output, wait until the input follows
+//
+static long gpio_n = 10000;
+
+static int test_gpio()
+{ long i, lat, lat_max, errors;
+  double lat_sum;
+  unsigned long long t0, t;
+  int level;
+
+  INP_GPIO(GPIO_IN);
+  INP_GPIO(GPIO_OUT);  OUT_GPIO(GPIO_OUT);
+  GPIO_CLR0 = 1<<GPIO_OUT;
+  short_wait();
+
+  errors = lat_max = 0;
+  lat_sum = 0;
+  t0 = get_time_ns();
+  for (i = 0; i < gpio_n && errors < MAX_ERRORS; i++)
+  {
+    level = !(i & 1);
+    t = get_time_ns();
+    if (level)
+      GPIO_SET0 = 1<<GPIO_OUT;
+    else
+      GPIO_CLR0 = 1<<GPIO_OUT;
+    while ((int)((GPIO_IN0 >> GPIO_IN) & 1) != level)
+      if (get_time_ns() - t > GPIO_TIMEOUT)
+        break;
+    lat = (long)(get_time_ns() - t);
+    if ((int)((GPIO_IN0 >> GPIO_IN) & 1) != level)
+    { printf("  GP%d did not go %s\n", GPIO_IN, level ? "high" : "low");
+      errors++;
+      continue;
+    }
+    lat_sum += lat;
+    if (lat > lat_max) lat_max = lat;
+  }
+  t = get_time_ns() - t0;
+  GPIO_CLR0 = 1<<GPIO_OUT;
+  INP_GPIO(GPIO_OUT);
+
+  if (errors)
+    return errors;
+  printf("  %ld writes in %.1f ms, loopback avg %.2f max %.2f us\n",
+         gpio_n, t/1e6, lat_sum/gpio_n/1e3, lat_max/1e3);
+  set_metric("gpio.toggle_rate", gpio_n * 1e9 / t);
+  set_metric("gpio.loop_avg_us", lat_sum / gpio_n / 1e3);
+  set_metric("gpio.loop_max_us", lat_max / 1e3);
+  return 0;
+} // test_gpio
+
+//
+// Every DAC code must come back from the ADC within DAC_TOL steps
+//
+static int test_dac()
+{ int code, r, v, expect, err, err_max, errors;
+  double err_sum;
+  unsigned long long t0, t;
+
+  INP_GPIO(7);  SET_GPIO_ALT(7,0);
+  INP_GPIO(8);  SET_GPIO_ALT(8,0);
+  INP_GPIO(9);  SET_GPIO_ALT(9,0);
+  INP_GPIO(10); SET_GPIO_ALT(10,0);
+  INP_GPIO(11); SET_GPIO_ALT(11,0);
+  setup_spi();
+
+  write_dac(DAC_CHAN, 0);
+  wait_until_ns(get_time_ns() + 1000000, 0);
+  errors = err_max = 0;
+  err_sum = 0;
+  t0 = get_time_ns();
+  for (code = 0; code < 256 && errors < MAX_ERRORS; code++)
+  {
+    write_dac(DAC_CHAN, code * 16);
+    v = 0;
+    for (r = 0; r < DAC_READS; r++)
+      v += read_adc(ADC_CHAN);
+    v = (v + DAC_READS/2) / DAC_READS;
+    // DAC: 2.048V full scale in 256 steps, ADC: 3.3V in 1024 steps
+    expect = (int)(code * 2.048 / 256 / 3.3 * 1024 + 0.5);
+    err = abs(v - expect);
+    err_sum += err;
+    if (err > err_max) err_max = err;
+    if (err > DAC_TOL)
+    { printf("  DAC code %d read back as %d, expected %d\n", code, v, expect);
+      errors++;
+    }
+  }
+  t = get_time_ns() - t0;
+  write_dac(DAC_CHAN, 0);
+
+  if (errors)
+    return errors;
+  printf("  256 codes in %.1f ms, error avg %.2f max %d ADC steps\n",
+         t/1e6, err_sum/256, err_max);
+  set_metric("dac.sweep_ms", t / 1e6);
+  set_metric("dac.err_avg_lsb", err_sum / 256);
+  set_metric("dac.err_max_lsb", err_max);
+  return 0;
+} // test_dac
+
+//
+// Set a few duty cycles and see how long the input is high
+// The time between two reads of the input counts for the level we
+// read first, so being preempted does not change the outcome much.
+//
+static int test_pwm()
+{ static const int duty[] = {10, 25, 50, 75, 90};
+  unsigned range;
+  unsigned long long t, prev, end, high_ns;
+  double hz, measured, err, err_max, upd_sum;
+  long upd;
+  int d, level, errors;
+
+  INP_GPIO(PWM_IN);
+  INP_GPIO(18);  SET_GPIO_ALT(18, 5);
+  if ((hz = gb_pwm_configure(PWM_HZ, 1000, &range)) == 0)
+  { printf("  Can't run the PWM at %d Hz\n", PWM_HZ);
+    return 1;
+  }
+
+  errors = 0;
+  err_max = upd_sum = 0;
+  for (d = 0; d < (int)(sizeof(duty)/sizeof(duty[0])); d++)
+  {
+    // mark-space mode: one pulse per period
+    upd = update_pwm(0, range * duty[d] / 100, PWM0_ENABLE|PWM0_MS_MODE);
+    if (upd < 0)
+    { printf("  PWM value did not arrive\n");
+      errors++;
+      continue;
+    }
+    upd_sum += upd;
+
+    high_ns = 0;
+    prev = get_time_ns();
+    end = prev + (unsigned long long)(PWM_PERIODS * 1e9 / hz);
+    level = (GPIO_IN0 >> PWM_IN) & 1;
+    do {
+      t = get_time_ns();
+      if (level)
+        high_ns += t - prev;
+      level = (GPIO_IN0 >> PWM_IN) & 1;
+      prev = t;
+    } while (t < end);
+    measured = 100.0 * high_ns / (PWM_PERIODS * 1e9 / hz);
+    err = measured - duty[d];
+    if (err < 0) err = -err;
+    if (err > err_max) err_max = err;
+    if (err > DUTY_TOL)
+    { printf("  duty cycle %d%% measured as %.1f%%\n", duty[d], measured);
+      errors++;
+    }
+  }
+  pwm_off();
+  INP_GPIO(18);
+
+  if (errors)
+    return errors;
+  printf("  %.1f Hz, duty cycle error max %.2f%%, update took avg %.0f us\n",
+         hz, err_max, upd_sum/d/1e3);
+  set_metric("pwm.duty_err_pct", err_max);
+  set_metric("pwm.update_avg_us", upd_sum / d / 1e3);
+  return 0;
+} // test_pwm
+
+//
+// Switch the driver, return the ns until GP22 followed or -1
+// The driver pulls GP22 low when it is on
+//
+static long oc_switch(int on)
+{ unsigned long long t;
+
+  t = get_time_ns();
+  if (on)
+    GPIO_SET0 = 1<<OC_OUT;
+  else
+    GPIO_CLR0 = 1<<OC_OUT;
+  while ((int)((GPIO_IN0 >> OC_IN) & 1) == on)
+    if (get_time_ns() - t > OC_TIMEOUT)
+      return -1;
+  return (long)(get_time_ns() - t);
+} // oc_switch
+
+static void oc_pull(int pull)
+{
+  // pull 2 is pull-up, 0 is none
+  GPIO_PULL = pull;
+  short_wait();
+  GPIO_PULLCLK0 = 1<<OC_IN;
+  short_wait();
+  GPIO_PULL = 0;
+  GPIO_PULLCLK0 = 0;
+} // oc_pull
+
+static int test_ocol()
+{ long on, off;
+  double on_sum, off_sum;
+  int i, errors;
+
+  INP_GPIO(OC_IN);
+  oc_pull(2);
+  INP_GPIO(OC_OUT);  OUT_GPIO(OC_OUT);
+
+  errors = 0;
+  on_sum = off_sum = 0;
+  if (oc_switch(0) < 0)
+  { printf("  GP%d stays low with the driver off\n", OC_IN);
+    errors++;
+  }
+  for (i = 0; i < OC_CYCLES && !errors; i++)
+  {
+    if ((on = oc_switch(1)) < 0)
+    { printf("  driver on but GP%d stays high\n", OC_IN);
+      errors++;
+    }
+    if ((off = oc_switch(0)) < 0)
+    { printf("  driver off but GP%d stays low\n", OC_IN);
+      errors++;
+    }
+    on_sum += on;
+    off_sum += off;
+  }
+  GPIO_CLR0 = 1<<OC_OUT;
+  INP_GPIO(OC_OUT);
+  oc_pull(0);
+
+  if (errors)
+    return errors;
+  printf("  %d cycles, switching on took avg %.1f us, off %.1f us\n",
+         OC_CYCLES, on_sum/OC_CYCLES/1e3, off_sum/OC_CYCLES/1e3);
+  set_metric("ocol.on_avg_us", on_sum / OC_CYCLES / 1e3);
+  set_metric("ocol.off_avg_us", off_sum / OC_CYCLES / 1e3);
+  return 0;
+} // test_ocol
+
+static const struct test {
+  const char *name;
+  int (*run)();
+  const char *wiring;
+} tests[] = {
+  { "gpio", test_gpio,
+    "GP25 in J2 --- GP24 in J2\n" },
+  { "dac",  test_dac,
+    "jumper connecting GP11 to SCLK\n"
+    "jumper connecting GP10 to MOSI\n"
+    "jumper connecting GP9 to MISO\n"
+    "jumper connecting GP8 to CSnA\n"
+    "jumper connecting GP7 to CSnB\n"
+    "jumper connecting DA1 on J29 to AD0 on J28\n" },
+  { "pwm",  test_pwm,
+    "GP18 in J2 --- GP23 in J2\n" },
+  { "ocol", test_ocol,
+    "GP4 in J2 --- RLY1 in J4\n"
+    "RLY1 in J12 --- GP22 in J2\n" },
+};
+#define N_TESTS (int)(sizeof(tests)/sizeof(tests[0]))
+
+static void write_results(const char *file)
+{ FILE *fp;
+  int i;
+
+  if ((fp = fopen(file, "w")) == NULL)
+  { printf("Can't open %s\n", file);
+    return;
+  }
+  fprintf(fp, "# selftest results, can be used as a baseline with -B\n");
+  for (i = 0; i < N_METRICS; i++)
+    if (metrics[i].valid)
+      fprintf(fp, "%s %.3f\n", metrics[i].name, metrics[i].value);
+  fclose(fp);
+} // write_results
+
+//
+// Compare with the numbers in a results file
+// Returns the number of regressions, -1 if the file can't be read
+//
+static int compare_baseline(const char *file, double tol)
+{ FILE *fp;
+  char line[128], name[64];
+  double base, limit;
+  struct metric *m;
+  int i, worse, n;
+
+  if ((fp = fopen(file, "r")) == NULL)
+  { printf("Can't open %s\n", file);
+    return -1;
+  }
+  n = 0;
+  printf("%-20s %10s %10s\n", "", "now", "baseline");
+  while (fgets(line, sizeof(line), fp))
+  {
+    if (line[0] == '#' || sscanf(line, "%63s %lf", name, &base) != 2)
+      continue;
+    for (i = 0; i < N_METRICS; i++)
+      if (!strcmp(metrics[i].name, name))
+        break;
+    if (i == N_METRICS || !metrics[i].valid)
+      continue;
+    m = &metrics[i];
+    if (m->better > 0)
+    { limit = base * (1 - tol/100) - m->slack;
+      worse = m->value < limit;
+    }
+    else
+    { limit = base * (1 + tol/100) + m->slack;
+      worse = m->value > limit;
+    }
+    printf("%-20s %10.3f %10.3f%s\n", name, m->value, base,
+           worse ? "  REGRESSION" : "");
+    n += worse;
+  }
+  fclose(fp);
+  return n;
+} // compare_baseline
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-b] [-n gpio_writes] [-o results] [-B baseline] [-T percent]\n"
+    "          [gpio] [dac] [pwm] [ocol]\n"
+    "  -b batch: no wiring help, do not wait for enter\n"
+    "  -T tolerance against the baseline, default 20%%\n"
+    "  without test names all tests are run\n", prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ int c, t, i, batch, run[N_TESTS], failed, ran, regressed;
+  char *out = NULL, *base = NULL;
+  double tol;
+
+  batch = 0;
+  tol   = 20;
+  while ((c = getopt(argc, argv, "bn:o:B:T:")) != -1)
+  {
+    switch (c)
+    {
+    case 'b' : batch  = 1; break;
+    case 'n' : gpio_n = atol(optarg); break;
+    case 'o' : out    = optarg; break;
+    case 'B' : base   = optarg; break;
+    case 'T' : tol    = atof(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (gpio_n <= 0 || tol < 0)
+    usage(argv[0]);
+  for (t = 0; t < N_TESTS; t++)
+    run[t] = optind == argc;
+  for (i = optind; i < argc; i++)
+  { for (t = 0; t < N_TESTS; t++)
+      if (!strcmp(argv[i], tests[t].name))
+        break;
+    if (t == N_TESTS)
+      usage(argv[0]);
+    run[t] = 1;
+  }
+
+  if (!batch)
+  {
+    printf ("These are the connections for the self test:\n");
+    for (t = 0; t < N_TESTS; t++)
+      if (run[t])
+        printf ("%s", tests[t].wiring);
+    printf ("When ready hit enter.\n");
+    (void) getchar();
+  }
+
+  // Map the I/O sections
+  setup_io();
+
+  // Optional real-time profile, see gb_rt.c
+  setup_rt_env();
+
+  failed = ran = 0;
+  for (t = 0; t < N_TESTS; t++)
+  {
+    if (!run[t])
+      continue;
+    printf("%s\n", tests[t].name);
+    c = tests[t].run();
+    printf("%-5s %s\n", tests[t].name, c ? "FAIL" : "PASS");
+    failed += c != 0;
+    ran++;
+  }
+
+  restore_rt();
+  restore_io();
+
+  if (out)
+    write_results(out);
+  regressed = base ? compare_baseline(base, tol) : 0;
+  printf("%d of %d tests passed", ran - failed, ran);
+  if (base && regressed < 0)
+    printf(", no baseline to compare with");
+  else if (base)
+    printf(", %d regressions against %s", regressed, base);
+  printf("\n");
+
+  // a baseline we could not read is a failure, not a pass
+  return failed || regressed ? EXIT_FAILURE : 0;
+} // main
@@ -0,0 +1,178 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Stepper motor test and benchmark
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Drive a unipolar stepper motor from four open collector drivers
+// (see gb_stepper.c), forwards and back again:
+//   sudo ./stepper -n 2000 -r 500 -a 1000
+//
+// Or find out how fast this Pi can step (disconnect the motor, it can
+// not follow): every rate runs 2 seconds of steps at that rate and we
+// look at how late the steps came.
+//   sudo ./stepper -B -P 80
+//
+
+#include "gb_common.h"
+#include "gb_rt.h"
+#include "gb_stepper.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// stepper test GPIO mapping:
+//         Function            Mode
+// GPIO22= coil 1 (RLY1)       Output
+// GPIO23= coil 2 (RLY2)       Output
+// GPIO24= coil 3 (RLY3)       Output
+// GPIO25= coil 4 (RLY4)       Output
+
+static const int coil_pin[4] = {22, 23, 24, 25};
+
+void setup_gpio()
+{ int c;
+  for (c = 0; c < 4; c++)
+  { INP_GPIO(coil_pin[c]);  OUT_GPIO(coil_pin[c]);
+  }
+} // setup_gpio
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-n steps] [-r max_rate] [-a accel] [-h] [-s spin_us]\n"
+    "          [-P rt_prio] [-B]\n"
+    "  -h half steps, -B benchmark the step rate\n", prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+//
+// Step at a fixed rate for 2 seconds per rate, report the lateness
+//
+static void benchmark(int half, unsigned long spin)
+{ static const double rates[] = {100, 200, 500, 1000, 2000, 5000, 10000,
+                                 20000, 50000, 100000, 200000};
+  struct stepper_stats st;
+  double best;
+  long interval;
+  int r;
+
+  best = 0;
+  printf("    rate  interval(us)  avg late(us)  max late(us)\n");
+  for (r = 0; r < (int)(sizeof(rates)/sizeof(rates[0])); r++)
+  { // no ramp: the first step is already at full rate
+    if (setup_stepper(coil_pin, half, rates[r], 1e12) ||
+        start_stepper(spin))
+      return;
+    queue_steps((long)(rates[r] * 2));
+    wait_stepper();
+    stop_stepper(&st);
+    interval = (long)(1e6 / rates[r]);
+    printf("%8.0f  %12ld  %12.1f  %12.1f\n", rates[r], interval,
+           st.late_sum / st.steps / 1000, st.late_max / 1000.0);
+    // a step may be a quarter interval late
+    if (st.late_max < interval * 1000 / 4)
+      best = rates[r];
+  }
+  printf("Highest rate with all steps within 1/4 interval: %.0f steps/s\n",
+         best);
+} // benchmark
+
+int main(int argc, char **argv)
+{ int c, half, prio, bench;
+  long n;
+  double rate, accel;
+  unsigned long spin;
+  struct stepper_stats st;
+
+  n     = 2000;
+  rate  = 500;
+  accel = 1000;
+  half  = 0;
+  prio  = 0;
+  spin  = 0;
+  bench = 0;
+  while ((c = getopt(argc, argv, "n:r:a:hs:P:B")) != -1)
+  {
+    switch (c)
+    {
+    case 'n' : n     = atol(optarg); break;
+    case 'r' : rate  = atof(optarg); break;
+    case 'a' : accel = atof(optarg); break;
+    case 'h' : half  = 1; break;
+    case 's' : spin  = atol(optarg) * 1000; break;
+    case 'P' : prio  = atoi(optarg); break;
+    case 'B' : bench = 1; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (n <= 0 || rate <= 0 || accel <= 0)
+    usage(argv[0]);
+
+  printf ("These are the connections for the stepper test:\n");
+  printf ("GP22 in J2 --- RLY1 in J4\n");
+  printf ("GP23 in J2 --- RLY2 in J4\n");
+  printf ("GP24 in J2 --- RLY3 in J4\n");
+  printf ("GP25 in J2 --- RLY4 in J4\n");
+  printf ("+ of external power source --- RPWR in J6\n");
+  printf ("ground of external power source --- GND (any)\n");
+  printf ("common wire(s) of the stepper --- + of external power source\n");
+  printf ("coil 1..4 of the stepper --- RLY1..4 in J12..J15\n");
+  if (bench)
+    printf ("(for the benchmark better leave the motor disconnected)\n");
+  printf ("When ready hit enter.\n");
+  (void) getchar();
+
+  // Map the I/O sections
+  setup_io();
+
+  setup_gpio();
+
+  // The stepper thread inherits the real-time profile
+  if (prio)
+    setup_rt(RT_DEFAULT, prio, 0);
+
+  if (bench)
+    benchmark(half, spin);
+  else if (setup_stepper(coil_pin, half, rate, accel) == 0 &&
+           start_stepper(spin) == 0)
+  { // there and back again
+    queue_steps(n);
+    queue_steps(-n);
+    wait_stepper();
+    stop_stepper(&st);
+    printf("%llu steps, lateness avg %.1f us max %.1f us\n", st.steps,
+           st.late_sum / st.steps / 1000, st.late_max / 1000.0);
+  }
+
+  if (prio)
+    restore_rt();
+  restore_io();
+  return 0;
+} // main
@@ -27,6 +27,10 @@
  */
 #ifdef gertboard_BACKEND
 #include "gb_common.h"
+#include "gb_rt.h"
+#include "gb_edge.h"
+#include "gb_debounce.h"
+#include "gb_event.h"
 #endif
 
 #include <assert.h>
@@ -139,8 +143,10 @@ static enum rod_e  get_next_action ();
  * Gertboard Input Backend.
  *
  * This code uses switches S1, S2 and S3 on the gertboard as the input for the
- * game, with a simple backend driver which polls the GPIO_IN0 port and
- * determines new button press actions based its value.
+ * game. The library input sampler debounces the GPIO_IN0 port and queues
+ * every clean switch press as an event, which we turn into an action.
+ * While the switches are idle the sampler sleeps until the kernel reports
+ * an edge on one of them.
  */
 
 #define GPIO_PULL_UP  2
@@ -157,11 +163,15 @@ static enum rod_e  get_next_action ();
 	GPIO_PULL = 0;				\
 	GPIO_PULLCLK0 = 0
 
-static unsigned int b, lb = 0, pb = 0x10;
+/* Sample the switches every 5ms while they bounce. */
+#define DEBOUNCE_PERIOD 5000000
+
+static struct event_reader events;
 
 static void sig_handler(int sig)
 {
 	if (sig == SIGINT) {
+		restore_edge();
 		set_gpio(GPIO_PULL, 0);
 		gpio_set_pull(0);
 		exit(EXIT_SUCCESS);
@@ -185,6 +195,19 @@ static inline void init_input_backend()
 
 	gpio_set_pull(GPIO_PULL_UP);
 
+	/* Optional real-time profile for the input poller, see gb_rt.c.
+	 * It must come before start_events(): the sampler thread takes
+	 * over the scheduling and CPU of the thread which creates it. */
+	setup_rt_env();
+
+	setup_edge(0x03800000, EDGE_BOTH);
+	/* The switches pull the inputs low when pressed. */
+	if (start_events(0x03800000, 0x03800000, DEBOUNCE_PERIOD)
+	    || open_events(&events) < 0) {
+		eprintf("Failed to start the input event sampler.\n");
+		abort();
+	}
+
 	if (unlikely(signal(SIGINT, sig_handler) == SIG_ERR)) {
 		eprintf("Failed to attach signal handler to SIGINT.\n");
 		abort();
@@ -212,30 +235,14 @@ static inline enum rod_e translate_button(unsigned int b)
 	}
 }
 
-static void pause_thread(unsigned int ticks)
-{
-	unsigned int t;
-
-	for (t = 0; t <= ticks; t++)
-		short_wait();
-}
-
 static enum rod_e get_next_action ()
 {
-	while (1) {
-		b = (~GPIO_IN0 >> 23) & 0x07;
-		if ((is_button(b) || b == 0) && b ^ pb) {
-			pb = b;
+	struct gb_event ev;
 
-			if (b && b ^ lb) {
-				lb = b;
-				return translate_button(b);
-			} else
-				lb = b;
-
-			pause_thread(100);
-		} else
-			pb = b;
+	while (1) {
+		gb_next_event(&events, &ev, -1);
+		if (ev.edge == EDGE_RISING)
+			return translate_button(1 << (ev.pin - 23));
 	}
 }
 
@@ -0,0 +1,150 @@
+//=============================================================================
+//
+//
+// Gertboard test suite
+//
+// Timing wheel benchmark
+//
+// This file is part of the gertboard test suite
+//
+//
+// Copyright (C) Gert Jan van Loo & Myra VanInwegen 2012
+// No rights reserved
+// You may treat this program as if it was in the public domain
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Try to strike a balance between keep code simple for
+// novice programmers but still have reasonable quality code
+//
+// Measure the timing wheel (gb_wheel.c) with more and more pending
+// timers: 10^3, 10^4 ... up to -n. No Gertboard needed, it runs on
+// any Linux box.
+//
+// All timers are added first, spread at random over a window that
+// starts 1 second later, then every 4th one is cancelled again and the
+// rest fire. We report the cost of an add and a cancel (which should
+// not grow with the number of timers) and how late the timers fired
+// (which should stay within about one tick).
+//
+//   ./wheelbench -n 1000000 -t 100 -w 2000
+//
+
+#include "gb_common.h"
+#include "gb_wheel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+static volatile unsigned long fired;
+
+static void count(void *arg)
+{
+  fired++;
+} // count
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-n max_timers] [-t tick_us] [-w window_ms] [-s spin_us]\n",
+    prog);
+  exit(EXIT_FAILURE);
+} // usage
+
+int main(int argc, char **argv)
+{ struct timer *tm;
+  struct wheel_stats st;
+  struct timespec ts = { 0, 10000000 };  // 10ms
+  unsigned long long t0, t_add, t_cancel, *when, r;
+  unsigned long tick, window, spin, expect;
+  long i, n, max;
+  int c;
+
+  max    = 1000000;
+  tick   = 100;   // us
+  window = 2000;  // ms
+  spin   = 0;
+  while ((c = getopt(argc, argv, "n:t:w:s:")) != -1)
+  {
+    switch (c)
+    {
+    case 'n' : max    = atol(optarg); break;
+    case 't' : tick   = atol(optarg); break;
+    case 'w' : window = atol(optarg); break;
+    case 's' : spin   = atol(optarg); break;
+    default: usage(argv[0]);
+    }
+  }
+  if (max < 1 || tick == 0 || window == 0)
+    usage(argv[0]);
+  tick   *= 1000;
+  window *= 1000000;
+  spin   *= 1000;
+
+  tm   = malloc(max * sizeof(struct timer));
+  when = malloc(max * sizeof(unsigned long long));
+  if (tm == NULL || when == NULL)
+  { printf("allocation error \n");
+    exit(-1);
+  }
+
+  printf("  timers  add(ns)  cancel(ns)    fired  late avg(us)  max(us)"
+         "  wakeups  cascaded\n");
+  for (n = 1000; ; n *= 10)
+  { if (n > max)
+      n = max;
+    if (start_wheel(tick, spin))
+      exit(-1);
+    fired = 0;
+
+    // the times first, so we only time add_timer
+    r = 88172645463325252ULL;
+    t0 = get_time_ns() + 1000000000ULL;
+    for (i = 0; i < n; i++)
+    { r ^= r << 13;  r ^= r >> 7;  r ^= r << 17;  // xorshift
+      when[i] = t0 + r % window;
+      setup_timer(&tm[i], count, NULL);
+    }
+
+    t_add = get_time_ns();
+    for (i = 0; i < n; i++)
+      add_timer(&tm[i], when[i]);
+    t_add = get_time_ns() - t_add;
+
+    t_cancel = get_time_ns();
+    for (i = 0; i < n; i += 4)
+      cancel_timer(&tm[i]);
+    t_cancel = get_time_ns() - t_cancel;
+
+    // wait for the rest, with a second to spare
+    expect = n - (n+3)/4;
+    while (fired < expect && get_time_ns() < t0 + window + 1000000000ULL)
+      nanosleep(&ts, NULL);
+    stop_wheel(&st);
+
+    printf("%8ld  %7.1f  %10.1f  %7llu  %12.1f  %7.1f  %7llu  %8llu%s\n",
+           n, (double)t_add / n, (double)t_cancel / ((n+3)/4), st.fired,
+           st.fired ? st.late_sum / st.fired / 1000 : 0,
+           st.late_max / 1000.0, st.wakeups, st.cascaded,
+           st.fired == expect ? "" : "  (timers lost!)");
+    if (n == max)
+      break;
+  }
+
+  free(tm);
+  free(when);
+  return 0;
+} // main